@@ -0,0 +1,553 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "RConClient.h"
+
+#include <HAL/PlatformProcess.h>
+#include <HAL/Runnable.h>
+#include <HAL/RunnableThread.h>
+#include <SocketSubsystem.h>
+#include <Sockets.h>
+
+#include "RConSocketPoller.h"
+
+DEFINE_LOG_CATEGORY_STATIC(RConClient, Log, Log);
+
+class FRConClient::FClientRunnable final : public FRunnable
+{
+public:
+    explicit FClientRunnable(FRConClient& InClient)
+        : Client{InClient}
+    {
+    }
+
+    uint32 Run() override
+    {
+        while (!bStopping)
+        {
+            Client.TickNetwork(Client.Settings.WaitTime);
+        }
+        return 0;
+    }
+
+    void Stop() override
+    {
+        bStopping = true;
+        Client.Poller->Wake();
+    }
+
+private:
+    FRConClient& Client;
+    std::atomic<bool> bStopping{false};
+};
+
+static ISocketSubsystem* GetSocketSubsystem()
+{
+    return ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+}
+
+FRConClient::~FRConClient()
+{
+    if (bStarted)
+        Stop();
+}
+
+bool FRConClient::Start(const FSettings& InSettings)
+{
+    if (bStarted)
+    {
+        UE_LOG(RConClient, Warning, TEXT("Attempt to start client, while already started"));
+        return false;
+    }
+
+    TUniquePtr<FRConSocketPoller> NewPoller = MakeUnique<FRConSocketPoller>();
+    if (!NewPoller->IsValid())
+    {
+        UE_LOG(RConClient, Error, TEXT("Failed to initialize socket poller"));
+        return false;
+    }
+
+    Settings = InSettings;
+    Poller = MoveTemp(NewPoller);
+    bStarted = true;
+
+    if (Settings.bUseThread)
+    {
+        if (FPlatformProcess::SupportsMultithreading())
+        {
+            ClientRunnable = MakeUnique<FClientRunnable>(*this);
+            ClientThread.Reset(FRunnableThread::Create(ClientRunnable.Get(), TEXT("RConClient")));
+        }
+        else
+        {
+            UE_LOG(RConClient, Warning, TEXT("Multithreading not supported, Tick() has to be called to make progress"));
+        }
+    }
+
+    return true;
+}
+
+void FRConClient::Tick()
+{
+    if (bStarted && !ClientThread)
+        TickNetwork(0);
+}
+
+void FRConClient::Stop()
+{
+    if (ClientThread)
+    {
+        ClientThread->Kill(true);
+        ClientThread.Reset();
+        ClientRunnable.Reset();
+    }
+
+    for (auto& [ConnectionId, Connection] : Connections)
+    {
+        CloseConnection(*Connection, TEXT("Client stopped"), false);
+        for (FRequest& Request : Connection->WaitingRequests)
+            FailRequest(Request, TEXT("Client stopped"));
+    }
+    Connections.Reset();
+
+    FCommand Command{};
+    while (Commands.Dequeue(Command))
+    {
+        if (Command.Promise)
+            Command.Promise->SetValue(FResponse{false, TEXT("Client stopped")});
+    }
+
+    Poller.Reset();
+    bStarted = false;
+}
+
+uint32 FRConClient::Connect(const FString& Address, uint16 Port, const FString& Password)
+{
+    if (!bStarted)
+        return 0;
+
+    const uint32 ConnectionId = ++LastConnectionId;
+    Commands.Enqueue(FCommand{ECommandType::Connect, ConnectionId, Address, Port, Password});
+    Poller->Wake();
+    return ConnectionId;
+}
+
+void FRConClient::Disconnect(uint32 ConnectionId)
+{
+    if (!bStarted)
+        return;
+
+    Commands.Enqueue(FCommand{ECommandType::Disconnect, ConnectionId});
+    Poller->Wake();
+}
+
+TFuture<FRConClient::FResponse> FRConClient::SendCommand(uint32 ConnectionId, FString Command)
+{
+    FCommand NewCommand{ECommandType::Send, ConnectionId};
+    NewCommand.Body = MoveTemp(Command);
+    TFuture<FResponse> Future = NewCommand.Promise.Emplace().GetFuture();
+
+    if (!bStarted)
+    {
+        NewCommand.Promise->SetValue(FResponse{false, TEXT("Client is not started")});
+        return Future;
+    }
+
+    Commands.Enqueue(MoveTemp(NewCommand));
+    Poller->Wake();
+    return Future;
+}
+
+void FRConClient::TickNetwork(uint32 WaitTime)
+{
+    // without readiness backend wait is a blind sleep, every response would be late by it
+    if (!FRConSocketPoller::HasReadinessBackend())
+        WaitTime = FMath::Min(WaitTime, 1u);
+
+    // connect completion is not reported by poller, keep checking on it often
+    for (const auto& [ConnectionId, Connection] : Connections)
+    {
+        if (Connection->State == EConnectionState::Connecting)
+        {
+            WaitTime = FMath::Min(WaitTime, 10u);
+            break;
+        }
+    }
+
+    ReadyKeys.Reset();
+    Poller->Wait(WaitTime, ReadyKeys);
+
+    ProcessCommands();
+
+    for (const uint32 Key : ReadyKeys)
+    {
+        TUniquePtr<FConnection>* Connection = Connections.Find(Key);
+        if (Connection && (*Connection)->Socket)
+            ProcessIncoming(**Connection);
+    }
+
+    const double Now = FPlatformTime::Seconds();
+    for (auto& [ConnectionId, Connection] : Connections)
+    {
+        UpdateConnection(*Connection, Now);
+        ProcessOutgoing(*Connection);
+    }
+}
+
+void FRConClient::ProcessCommands()
+{
+    const double Now = FPlatformTime::Seconds();
+
+    FCommand Command{};
+    while (Commands.Dequeue(Command))
+    {
+        switch (Command.Type)
+        {
+        case ECommandType::Connect:
+        {
+            TUniquePtr<FConnection>& Connection = Connections.Emplace(Command.ConnectionId, MakeUnique<FConnection>());
+            Connection->Id = Command.ConnectionId;
+            Connection->Address = MoveTemp(Command.Address);
+            Connection->Port = Command.Port;
+            Connection->Password = MoveTemp(Command.Body);
+            Connection->bReconnect = true;
+            Connection->NextConnectTime = Now;
+            // fit at least two max sized packets, so partial one never blocks receiving
+            Connection->RecvBuffer.Init(2 * (Settings.MaxPacketSize + CRConPacketSizeFieldLength));
+            break;
+        }
+        case ECommandType::Disconnect:
+        {
+            TUniquePtr<FConnection> Connection{};
+            if (Connections.RemoveAndCopyValue(Command.ConnectionId, Connection))
+            {
+                CloseConnection(*Connection, TEXT("Disconnected"), false);
+                for (FRequest& Request : Connection->WaitingRequests)
+                    FailRequest(Request, TEXT("Disconnected"));
+            }
+            break;
+        }
+        case ECommandType::Send:
+        {
+            TUniquePtr<FConnection>* Connection = Connections.Find(Command.ConnectionId);
+            if (!Connection || (!(*Connection)->bReconnect && (*Connection)->State == EConnectionState::Disconnected))
+            {
+                Command.Promise->SetValue(FResponse{false, TEXT("Not connected")});
+                break;
+            }
+
+            FRequest Request{MoveTemp(*Command.Promise), MoveTemp(Command.Body)};
+            Request.Deadline = Now + Settings.RequestTimeout;
+
+            if ((*Connection)->State == EConnectionState::Ready)
+                SendRequest(**Connection, MoveTemp(Request));
+            else
+                (*Connection)->WaitingRequests.Add(MoveTemp(Request));
+            break;
+        }
+        }
+    }
+}
+
+void FRConClient::UpdateConnection(FConnection& Connection, double Now)
+{
+    if (Connection.State == EConnectionState::Disconnected && Connection.bReconnect && Now >= Connection.NextConnectTime)
+    {
+        OpenSocket(Connection, Now);
+    }
+    else if (Connection.State == EConnectionState::Connecting)
+    {
+        const ESocketConnectionState ConnectionState = Connection.Socket->GetConnectionState();
+        if (ConnectionState == SCS_Connected)
+        {
+            Connection.State = EConnectionState::Authenticating;
+            FRConPacket::SerializePacket(Connection.SendBuffer, AuthPacketId, ERConPacketType::Auth, Connection.Password);
+        }
+        else if (ConnectionState == SCS_ConnectionError || Now >= Connection.ConnectDeadline)
+        {
+            UE_LOG(RConClient, Warning, TEXT("Failed to connect to %s:%d"), *Connection.Address, Connection.Port);
+            CloseConnection(Connection, TEXT("Failed to connect"), true);
+        }
+    }
+    else if (Connection.State == EConnectionState::Authenticating && Now >= Connection.ConnectDeadline)
+    {
+        UE_LOG(RConClient, Warning, TEXT("Authentication timed out on %s:%d"), *Connection.Address, Connection.Port);
+        CloseConnection(Connection, TEXT("Authentication timed out"), true);
+    }
+
+    for (int32 i = Connection.WaitingRequests.Num() - 1; i > -1; --i)
+    {
+        if (Connection.WaitingRequests[i].Deadline <= Now)
+        {
+            FailRequest(Connection.WaitingRequests[i], TEXT("Request timed out waiting for connection"));
+            Connection.WaitingRequests.RemoveAt(i, EAllowShrinking::No);
+        }
+    }
+
+    for (auto It = Connection.Requests.CreateIterator(); It; ++It)
+    {
+        if (It.Value().Deadline <= Now)
+        {
+            FailRequest(It.Value(), TEXT("Request timed out"));
+            It.RemoveCurrent();
+        }
+    }
+}
+
+void FRConClient::OpenSocket(FConnection& Connection, double Now)
+{
+    ISocketSubsystem* SocketSubsystem = GetSocketSubsystem();
+
+    TSharedPtr<FInternetAddr> ServerAddress = SocketSubsystem->GetAddressFromString(Connection.Address);
+    if (!ServerAddress)
+    {
+        UE_LOG(RConClient, Error, TEXT("Invalid server address: %s"), *Connection.Address);
+        CloseConnection(Connection, TEXT("Invalid server address"), false);
+        for (FRequest& Request : Connection.WaitingRequests)
+            FailRequest(Request, TEXT("Invalid server address"));
+        Connection.WaitingRequests.Reset();
+        return;
+    }
+    ServerAddress->SetPort(Connection.Port);
+
+    Connection.Socket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("RConClient"), ServerAddress->GetProtocolType());
+    if (!Connection.Socket)
+    {
+        CloseConnection(Connection, TEXT("Failed to create socket"), true);
+        return;
+    }
+
+    Connection.Socket->SetNonBlocking();
+    Connection.Socket->SetNoDelay();
+
+    // non-blocking connect completes later, GetConnectionState tells when
+    bool bConnecting = Connection.Socket->Connect(*ServerAddress);
+    if (!bConnecting)
+    {
+        const ESocketErrors ErrorCode = SocketSubsystem->GetLastErrorCode();
+        bConnecting = ErrorCode == SE_EINPROGRESS || ErrorCode == SE_EWOULDBLOCK;
+    }
+
+    Connection.State = EConnectionState::Connecting;
+    Connection.ConnectDeadline = Now + Settings.RequestTimeout;
+    if (!bConnecting || !Poller->Add(Connection.Socket, Connection.Id))
+    {
+        UE_LOG(RConClient, Warning, TEXT("Failed to connect to %s:%d"), *Connection.Address, Connection.Port);
+        CloseConnection(Connection, TEXT("Failed to connect"), true);
+    }
+}
+
+void FRConClient::CloseConnection(FConnection& Connection, const TCHAR* Reason, bool bReconnect)
+{
+    if (Connection.Socket)
+    {
+        Poller->Remove(Connection.Socket, Connection.Id);
+        Connection.Socket->Close();
+        GetSocketSubsystem()->DestroySocket(Connection.Socket);
+        Connection.Socket = nullptr;
+    }
+
+    // sent requests can't be resumed on new connection, there is no way to know whether they executed
+    for (auto& [PacketId, Request] : Connection.Requests)
+        FailRequest(Request, Reason);
+    Connection.Requests.Reset();
+
+    Connection.State = EConnectionState::Disconnected;
+    Connection.SendBuffer.Reset();
+    Connection.SendOffset = 0;
+    Connection.RecvBuffer.Reset();
+
+    Connection.bReconnect = bReconnect && Settings.ReconnectDelay > 0.0;
+    Connection.NextConnectTime = FPlatformTime::Seconds() + Settings.ReconnectDelay;
+
+    // nothing would take waiting requests anymore
+    if (!Connection.bReconnect)
+    {
+        for (FRequest& Request : Connection.WaitingRequests)
+            FailRequest(Request, Reason);
+        Connection.WaitingRequests.Reset();
+    }
+}
+
+void FRConClient::SendRequest(FConnection& Connection, FRequest&& Request)
+{
+    // keep ids positive even after wrap around, auth id never reused
+    if (Connection.NextPacketId < 2 || Connection.NextPacketId > MAX_int32 - 2)
+        Connection.NextPacketId = 2;
+
+    const int32 PacketId = Connection.NextPacketId;
+    Connection.NextPacketId += 2;
+
+    FRConPacket::SerializePacket(Connection.SendBuffer, PacketId, ERConPacketType::ExecCommand, Request.Command);
+    Request.Command.Empty();
+
+    FRequest& SentRequest = Connection.Requests.Emplace(PacketId, MoveTemp(Request));
+    SendTerminator(Connection, PacketId, SentRequest);
+}
+
+void FRConClient::SendTerminator(FConnection& Connection, int32 PacketId, FRequest& Request)
+{
+    // mirrored back only after every packet of responses sent before it
+    FRConPacket::SerializePacket(Connection.SendBuffer, PacketId + 1, ERConPacketType::ResponseValue, FStringView());
+    Request.bTerminatorPending = true;
+}
+
+void FRConClient::ProcessIncoming(FConnection& Connection)
+{
+    FRConRingBuffer& RecvBuffer = Connection.RecvBuffer;
+
+    while (Connection.Socket)
+    {
+        int32 RegionSize{};
+        uint8* Region = RecvBuffer.GetWriteRegion(RegionSize);
+        if (RegionSize == 0)
+            return;
+
+        // non-blocking recv fails only when peer closed connection or on error, no data is not a failure
+        int32 BytesRead{};
+        if (!Connection.Socket->Recv(Region, RegionSize, BytesRead))
+        {
+            UE_LOG(RConClient, Log, TEXT("Connection to %s:%d lost"), *Connection.Address, Connection.Port);
+            CloseConnection(Connection, TEXT("Connection lost"), true);
+            return;
+        }
+
+        if (BytesRead == 0)
+            return;
+
+        RecvBuffer.Commit(BytesRead);
+        ProcessReceivedPackets(Connection);
+
+        // socket drained, otherwise free region was too small and there could be more data
+        if (BytesRead < RegionSize)
+            return;
+    }
+}
+
+void FRConClient::ProcessReceivedPackets(FConnection& Connection)
+{
+    FRConRingBuffer& RecvBuffer = Connection.RecvBuffer;
+    FRConPacket Packet{};
+
+    while (Connection.Socket && RecvBuffer.Num() >= CRConPacketSizeFieldLength)
+    {
+        int32 PacketSize{};
+        RecvBuffer.Peek(reinterpret_cast<uint8*>(&PacketSize), CRConPacketSizeFieldLength);
+        PacketSize = INTEL_ORDER32(PacketSize);
+
+        if (PacketSize < CRConMinPacketSize || PacketSize > Settings.MaxPacketSize)
+        {
+            UE_LOG(RConClient, Warning, TEXT("Server %s:%d sent malformed packet with size %d, closing connection"), *Connection.Address, Connection.Port, PacketSize);
+            CloseConnection(Connection, TEXT("Malformed response"), true);
+            return;
+        }
+
+        const int32 FrameSize = PacketSize + CRConPacketSizeFieldLength;
+        if (RecvBuffer.Num() < FrameSize)
+            return; // wait for the rest of the packet
+
+        const uint8* FrameData = RecvBuffer.Linearize(FrameSize, Connection.RecvScratch);
+        const bool bPacketOk = FRConPacket::DeserializePacket(FrameData, FrameSize, Packet, Settings.MaxPacketSize);
+        RecvBuffer.Consume(FrameSize);
+
+        if (bPacketOk)
+            ProcessPacket(Connection, Packet);
+        else
+            UE_LOG(RConClient, Warning, TEXT("Server %s:%d sent packet with invalid body, packet dropped"), *Connection.Address, Connection.Port);
+    }
+}
+
+void FRConClient::ProcessPacket(FConnection& Connection, FRConPacket& Packet)
+{
+    if (Connection.State == EConnectionState::Authenticating)
+    {
+        // some servers send empty response value ahead of auth response
+        if (Packet.Type != ERConPacketType::AuthResponse)
+            return;
+
+        if (Packet.Id != AuthPacketId)
+        {
+            UE_LOG(RConClient, Error, TEXT("Authentication failure on %s:%d"), *Connection.Address, Connection.Port);
+            // retrying with the same password is pointless
+            CloseConnection(Connection, TEXT("Authentication failure"), false);
+            return;
+        }
+
+        UE_LOG(RConClient, Log, TEXT("Connected to %s:%d"), *Connection.Address, Connection.Port);
+        Connection.State = EConnectionState::Ready;
+
+        TArray<FRequest> WaitingRequests = MoveTemp(Connection.WaitingRequests);
+        for (FRequest& Request : WaitingRequests)
+            SendRequest(Connection, MoveTemp(Request));
+        return;
+    }
+
+    if (Connection.State != EConnectionState::Ready || Packet.Type != ERConPacketType::ResponseValue)
+        return;
+
+    if ((Packet.Id & 1) == 0)
+    {
+        FRequest* Request = Connection.Requests.Find(Packet.Id);
+        if (!Request)
+            return;
+
+        Request->Body.Append(Packet.Body);
+        Request->bReceivedData = true;
+
+        // delayed response arrived after terminator was mirrored, need another one to know when it ends
+        if (!Request->bTerminatorPending)
+            SendTerminator(Connection, Packet.Id, *Request);
+    }
+    else
+    {
+        const int32 RequestPacketId = Packet.Id - 1;
+        FRequest* Request = Connection.Requests.Find(RequestPacketId);
+        if (!Request)
+            return;
+
+        Request->bTerminatorPending = false;
+        if (Request->bReceivedData)
+        {
+            Request->Promise.SetValue(FResponse{true, MoveTemp(Request->Body)});
+            Connection.Requests.Remove(RequestPacketId);
+        }
+    }
+}
+
+void FRConClient::ProcessOutgoing(FConnection& Connection)
+{
+    if (!Connection.Socket || Connection.State == EConnectionState::Connecting)
+        return;
+
+    const int32 PendingSize = Connection.SendBuffer.Num() - Connection.SendOffset;
+    if (PendingSize <= 0)
+        return;
+
+    int32 BytesSent{};
+    if (!Connection.Socket->Send(Connection.SendBuffer.GetData() + Connection.SendOffset, PendingSize, BytesSent))
+    {
+        const ESocketErrors ErrorCode = GetSocketSubsystem()->GetLastErrorCode();
+        if (ErrorCode != SE_EWOULDBLOCK)
+        {
+            UE_LOG(RConClient, Warning, TEXT("Failed to send to %s:%d, error code %i"), *Connection.Address, Connection.Port, static_cast<int32>(ErrorCode));
+            CloseConnection(Connection, TEXT("Connection lost"), true);
+        }
+        return;
+    }
+
+    Connection.SendOffset += BytesSent;
+    if (Connection.SendOffset == Connection.SendBuffer.Num())
+    {
+        Connection.SendBuffer.Reset();
+        Connection.SendOffset = 0;
+    }
+    else if (Connection.SendOffset > Connection.SendBuffer.Num() / 2)
+    {
+        Connection.SendBuffer.RemoveAt(0, Connection.SendOffset, EAllowShrinking::No);
+        Connection.SendOffset = 0;
+    }
+}
+
+void FRConClient::FailRequest(FRequest& Request, const TCHAR* Reason)
+{
+    Request.Promise.SetValue(FResponse{false, Reason});
+}
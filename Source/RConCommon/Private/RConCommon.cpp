@@ -2,6 +2,12 @@
 
 #include "RConCommon.h"
 
+#include "RConStats.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif
+
 IMPLEMENT_MODULE(FRConCommonModule, RConCommon)
 
 TArray<uint8> FRConPacket::Serialize() const
@@ -12,46 +18,277 @@ TArray<uint8> FRConPacket::Serialize() const
 TArray<uint8> FRConPacket::SerializePacket(const FRConPacket& Packet)
 {
     TArray<uint8> OutData{};
+    SerializePacket(OutData, Packet.Id, Packet.Type, Packet.Body);
+    return OutData;
+}
+
+int32 FRConPacket::GetBodyUtf8Length(FStringView Body)
+{
+    return FPlatformString::ConvertedLength<UTF8CHAR>(Body.GetData(), Body.Len());
+}
+
+int32 FRConPacket::GetBodyChunkLength(FStringView Body, int32 MaxUtf8Length)
+{
+    const TCHAR* Data = Body.GetData();
+    const int32 Length = Body.Len();
+
+    int32 Utf8Length{};
+    int32 Index{};
+    while (Index < Length)
+    {
+        const uint32 Char = static_cast<uint32>(Data[Index]);
+
+        int32 CharLength = 1;
+        int32 CharUtf8Length = 4;
+        if (Char < 0x80)
+            CharUtf8Length = 1;
+        else if (Char < 0x800)
+            CharUtf8Length = 2;
+        else if (Char >= 0xD800 && Char <= 0xDBFF && Index + 1 < Length)
+            CharLength = 2; // surrogate pair, never split it
+        else if (Char < 0x10000)
+            CharUtf8Length = 3;
+
+        if (Utf8Length + CharUtf8Length > MaxUtf8Length)
+            break;
+
+        Utf8Length += CharUtf8Length;
+        Index += CharLength;
+    }
+    return Index;
+}
+
+static void WritePacket(uint8* OutData, int32 PacketSize, int32 Id, ERConPacketType Type, FStringView Body)
+{
+    const int32 Header[3] = {
+        INTEL_ORDER32(PacketSize - CRConPacketSizeFieldLength),
+        INTEL_ORDER32(Id),
+        INTEL_ORDER32(static_cast<int32>(Type))};
+    FMemory::Memcpy(OutData, Header, CRConBasePacketSize);
+
+    const int32 BodyLength = PacketSize - CRConBasePacketSize - 2;
+    FPlatformString::Convert(reinterpret_cast<UTF8CHAR*>(OutData + CRConBasePacketSize), BodyLength, Body.GetData(), Body.Len());
+
+    OutData[PacketSize - 2] = 0;
+    OutData[PacketSize - 1] = 0;
+}
+
+void FRConPacket::SerializePacket(TArray<uint8>& OutData, int32 Id, ERConPacketType Type, FStringView Body)
+{
+    // trace scopes only, cycle stat per packet would cost more than serialization of small one
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConPacket::SerializePacket);
+
+    const int32 PacketSize = GetSerializedSize(GetBodyUtf8Length(Body));
+    const int32 Offset = OutData.AddUninitialized(PacketSize);
+    WritePacket(OutData.GetData() + Offset, PacketSize, Id, Type, Body);
+}
+
+int32 FRConPacket::SerializePacket(uint8* OutData, int32 Capacity, int32 Id, ERConPacketType Type, FStringView Body)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConPacket::SerializePacket);
 
-    FTCHARToUTF8 Utf8(*Packet.Body);
-    const int32 Size = 4 + 4 + Utf8.Length() + 2;
+    const int32 PacketSize = GetSerializedSize(GetBodyUtf8Length(Body));
+    if (PacketSize > Capacity)
+        return 0;
 
-#if PLATFORM_LITTLE_ENDIAN
-    OutData.Append((uint8*)&Size, 4);
-    OutData.Append((uint8*)&Packet.Id, 4);
-    OutData.Append((uint8*)&Packet.Type, 4);
+    WritePacket(OutData, PacketSize, Id, Type, Body);
+    return PacketSize;
+}
+
+namespace
+{
+    // @return length of leading bytes, that are neither null nor part of multi-byte UTF-8 sequence
+    int32 GetAsciiPrefixLength(const uint8* Data, int32 Size)
+    {
+        int32 Index{};
+#if PLATFORM_CPU_X86_FAMILY
+        const __m128i Zero = _mm_setzero_si128();
+        for (; Index + 16 <= Size; Index += 16)
+        {
+            const __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Data + Index));
+            // high bit marks non-ASCII bytes, null bytes compared separately
+            const int32 Mask = _mm_movemask_epi8(Bytes) | _mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, Zero));
+            if (Mask != 0)
+                return Index + static_cast<int32>(FMath::CountTrailingZeros(static_cast<uint32>(Mask)));
+        }
 #else
-    const int32 LeRespSize = NETWORK_ORDER32(Size);
-    const int32 LeRespId = NETWORK_ORDER32(Packet.Id);
-    const int32 LeRespType = NETWORK_ORDER32((int32)Packet.Type);
-    Response.Append((uint8*)&LeRespSize, 4);
-    Response.Append((uint8*)&LeRespId, 4);
-    Response.Append((uint8*)&LeRespType, 4);
+        constexpr uint64 LowBits = 0x0101010101010101ull;
+        constexpr uint64 HighBits = 0x8080808080808080ull;
+        for (; Index + 8 <= Size; Index += 8)
+        {
+            uint64 Word;
+            FMemory::Memcpy(&Word, Data + Index, sizeof(Word));
+            // non-ASCII or null byte somewhere in the word, scalar loop below finds which one
+            if (((Word | ((Word - LowBits) & ~Word)) & HighBits) != 0)
+                break;
+        }
 #endif
+        while (Index < Size && Data[Index] != 0 && Data[Index] < 0x80)
+            ++Index;
+        return Index;
+    }
 
-    OutData.Append((uint8*)Utf8.Get(), Utf8.Length());
-    OutData.Add(0);
-    OutData.Add(0);
+    // @return length of UTF-8 sequence at the start of Data, or 0 if it is truncated, overlong, surrogate or above U+10FFFF
+    int32 DecodeUtf8Char(const uint8* Data, int32 Size, uint32& OutCodepoint)
+    {
+        const uint8 Lead = Data[0];
 
-    return OutData;
+        int32 Length{};
+        uint32 Codepoint{};
+        uint32 MinCodepoint{};
+        if (Lead < 0x80)
+        {
+            OutCodepoint = Lead;
+            return 1;
+        }
+        else if ((Lead & 0xE0) == 0xC0)
+        {
+            Length = 2;
+            Codepoint = Lead & 0x1F;
+            MinCodepoint = 0x80;
+        }
+        else if ((Lead & 0xF0) == 0xE0)
+        {
+            Length = 3;
+            Codepoint = Lead & 0x0F;
+            MinCodepoint = 0x800;
+        }
+        else if ((Lead & 0xF8) == 0xF0)
+        {
+            Length = 4;
+            Codepoint = Lead & 0x07;
+            MinCodepoint = 0x10000;
+        }
+        else
+        {
+            return 0;
+        }
+
+        if (Length > Size)
+            return 0;
+
+        for (int32 i = 1; i < Length; ++i)
+        {
+            if ((Data[i] & 0xC0) != 0x80)
+                return 0;
+            Codepoint = (Codepoint << 6) | (Data[i] & 0x3F);
+        }
+
+        if (Codepoint < MinCodepoint || Codepoint > 0x10FFFF || (Codepoint >= 0xD800 && Codepoint <= 0xDFFF))
+            return 0;
+
+        OutCodepoint = Codepoint;
+        return Length;
+    }
+
+    // decode null terminated UTF-8 body, never reading past Size even if terminator is missing
+    bool DecodeBody(const uint8* Data, int32 Size, FString& OutBody)
+    {
+        TArray<TCHAR>& Chars = OutBody.GetCharArray();
+        // UTF-8 never takes less bytes than TCHARs needed for the same text, plus terminator
+        Chars.SetNumUninitialized(Size + 1, EAllowShrinking::No);
+        TCHAR* OutChars = Chars.GetData();
+
+        int32 Written{};
+        int32 Index{};
+        while (true)
+        {
+            // most of admin traffic is ASCII, copied without decoding
+            const int32 AsciiLength = GetAsciiPrefixLength(Data + Index, Size - Index);
+            for (int32 i = 0; i < AsciiLength; ++i)
+                OutChars[Written + i] = static_cast<TCHAR>(Data[Index + i]);
+            Written += AsciiLength;
+            Index += AsciiLength;
+
+            if (Index == Size || Data[Index] == 0)
+                break;
+
+            uint32 Codepoint{};
+            const int32 CharLength = DecodeUtf8Char(Data + Index, Size - Index, Codepoint);
+            if (CharLength == 0)
+            {
+                Chars.Reset();
+                return false;
+            }
+            Index += CharLength;
+
+            if constexpr (sizeof(TCHAR) == 2)
+            {
+                if (Codepoint >= 0x10000)
+                {
+                    Codepoint -= 0x10000;
+                    OutChars[Written++] = static_cast<TCHAR>(0xD800 + (Codepoint >> 10));
+                    OutChars[Written++] = static_cast<TCHAR>(0xDC00 + (Codepoint & 0x3FF));
+                    continue;
+                }
+            }
+            OutChars[Written++] = static_cast<TCHAR>(Codepoint);
+        }
+
+        if (Written == 0)
+        {
+            Chars.Reset();
+        }
+        else
+        {
+            OutChars[Written] = TEXT('\0');
+            Chars.SetNum(Written + 1, EAllowShrinking::No);
+        }
+        return true;
+    }
+} // namespace
+
+bool FRConPacket::DeserializePacket(const uint8* Data, int32 Size, FRConPacket& OutPacket, int32 MaxPacketSize)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConPacket::DeserializePacket);
+
+    if (Size < CRConPacketSizeFieldLength + CRConMinPacketSize)
+        return false;
+
+    int32 Header[3];
+    FMemory::Memcpy(Header, Data, CRConBasePacketSize);
+
+    const int32 PacketSize = INTEL_ORDER32(Header[0]);
+    if (PacketSize != Size - CRConPacketSizeFieldLength || PacketSize > MaxPacketSize)
+        return false;
+
+    // body terminator, or terminator of empty string following it, which some clients omit
+    if (Data[Size - 1] != 0)
+        return false;
+
+    OutPacket.Id = INTEL_ORDER32(Header[1]);
+    OutPacket.Type = static_cast<ERConPacketType>(INTEL_ORDER32(Header[2]));
+
+    return DecodeBody(Data + CRConBasePacketSize, Size - CRConBasePacketSize - 1, OutPacket.Body);
 }
 
-TPair<bool, FRConPacket> FRConPacket::DeserializePacket(uint8* Data, int32 Size)
+int32 FRConPacket::DeserializePackets(const uint8* Data, int32 Size, TArray<FRConPacket>& OutPackets, int32& OutNumPackets, int32 MaxPacketSize)
 {
-    if (Size < CRConBasePacketSize)
-        return TPair<bool, FRConPacket>();
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConPacket::DeserializePackets);
 
-    FRConPacket OutPacket{};
+    OutNumPackets = 0;
 
-    FMemory::Memcpy(&OutPacket.Id, Data + 4, 4);
-    FMemory::Memcpy(&OutPacket.Type, Data + 8, 4);
+    int32 Offset{};
+    while (Size - Offset >= CRConPacketSizeFieldLength)
+    {
+        int32 PacketSize{};
+        FMemory::Memcpy(&PacketSize, Data + Offset, CRConPacketSizeFieldLength);
+        PacketSize = INTEL_ORDER32(PacketSize);
 
-#if PLATFORM_LITTLE_ENDIAN == 0
-    OutPacket.Id = NETWORK_ORDER32(OutPacket.Id);
-    OutPacket.Type = static_cast<ERConPacketType>(NETWORK_ORDER32((int32)OutPacket.Type));
-#endif
+        if (PacketSize < CRConMinPacketSize || PacketSize > MaxPacketSize)
+            return INDEX_NONE;
+
+        const int32 FrameSize = PacketSize + CRConPacketSizeFieldLength;
+        if (Size - Offset < FrameSize)
+            break;
+
+        if (OutPackets.Num() == OutNumPackets)
+            OutPackets.AddDefaulted();
 
-    OutPacket.Body = FString(UTF8_TO_TCHAR(reinterpret_cast<char*>(Data + CRConBasePacketSize)));
+        if (DeserializePacket(Data + Offset, FrameSize, OutPackets[OutNumPackets], MaxPacketSize))
+            ++OutNumPackets;
 
-    return TPair<bool, FRConPacket>(true, OutPacket);
+        Offset += FrameSize;
+    }
+    return Offset;
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "RConResponseWriter.h"
+
+void FRConResponseWriter::Reset(ERConResponseFormat InFormat)
+{
+    Format = InFormat;
+    // keeps allocation, sized by biggest response so far
+    Buffer.Reset();
+    Scopes.Reset();
+    Scopes.Add(FScope{EScope::Object, false});
+    bObjectStart = false;
+
+    if (Format == ERConResponseFormat::Json)
+        Buffer.AppendChar(TEXT('{'));
+}
+
+void FRConResponseWriter::WriteString(FStringView Name, FStringView Value)
+{
+    BeginField(Name);
+    if (Format == ERConResponseFormat::Json)
+    {
+        Buffer.AppendChar(TEXT('"'));
+        AppendJsonEscaped(Buffer, Value);
+        Buffer.AppendChar(TEXT('"'));
+    }
+    else
+    {
+        Buffer.Append(Value);
+    }
+    EndField();
+}
+
+void FRConResponseWriter::WriteInt(FStringView Name, int64 Value)
+{
+    BeginField(Name);
+    Buffer.Appendf(TEXT("%lld"), Value);
+    EndField();
+}
+
+void FRConResponseWriter::WriteDouble(FStringView Name, double Value)
+{
+    BeginField(Name);
+    // JSON has no representation for NaN and infinity
+    if (Format == ERConResponseFormat::Json && !FMath::IsFinite(Value))
+        Buffer.Append(TEXT("null"));
+    else
+        Buffer.Appendf(TEXT("%.15g"), Value);
+    EndField();
+}
+
+void FRConResponseWriter::WriteBool(FStringView Name, bool Value)
+{
+    BeginField(Name);
+    Buffer.Append(Value ? TEXT("true") : TEXT("false"));
+    EndField();
+}
+
+void FRConResponseWriter::BeginArray(FStringView Name)
+{
+    BeginField(Name);
+    Buffer.AppendChar(Format == ERConResponseFormat::Json ? TEXT('[') : TEXT('\n'));
+    Scopes.Add(FScope{EScope::Array, false});
+}
+
+void FRConResponseWriter::EndArray()
+{
+    check(Scopes.Num() > 1 && Scopes.Last().Type == EScope::Array);
+    Scopes.Pop(EAllowShrinking::No);
+
+    if (Format == ERConResponseFormat::Json)
+        Buffer.AppendChar(TEXT(']'));
+}
+
+void FRConResponseWriter::BeginObject()
+{
+    check(Scopes.Last().Type == EScope::Array);
+
+    if (Format == ERConResponseFormat::Json)
+    {
+        if (Scopes.Last().bHasElements)
+            Buffer.AppendChar(TEXT(','));
+        Buffer.AppendChar(TEXT('{'));
+    }
+    Scopes.Last().bHasElements = true;
+    Scopes.Add(FScope{EScope::Object, false});
+    bObjectStart = true;
+}
+
+void FRConResponseWriter::EndObject()
+{
+    check(Scopes.Num() > 1 && Scopes.Last().Type == EScope::Object);
+    Scopes.Pop(EAllowShrinking::No);
+    bObjectStart = false;
+
+    if (Format == ERConResponseFormat::Json)
+        Buffer.AppendChar(TEXT('}'));
+}
+
+const FString& FRConResponseWriter::Finish()
+{
+    if (Format == ERConResponseFormat::Json)
+    {
+        while (Scopes.Num())
+            Buffer.AppendChar(Scopes.Pop(EAllowShrinking::No).Type == EScope::Array ? TEXT(']') : TEXT('}'));
+    }
+    else
+    {
+        Scopes.Reset();
+        Buffer.RemoveFromEnd(TEXT("\n"));
+    }
+
+    return Buffer;
+}
+
+void FRConResponseWriter::AppendJsonEscaped(FString& Out, FStringView Value)
+{
+    // runs of characters that need no escaping appended at once
+    int32 RunStart{0};
+    for (int32 i = 0; i < Value.Len(); ++i)
+    {
+        const TCHAR Char = Value[i];
+        if (Char >= 0x20 && Char != TEXT('"') && Char != TEXT('\\'))
+            continue;
+
+        Out.Append(Value.GetData() + RunStart, i - RunStart);
+        RunStart = i + 1;
+
+        switch (Char)
+        {
+        case TEXT('"'):
+            Out.Append(TEXT("\\\""));
+            break;
+        case TEXT('\\'):
+            Out.Append(TEXT("\\\\"));
+            break;
+        case TEXT('\n'):
+            Out.Append(TEXT("\\n"));
+            break;
+        case TEXT('\r'):
+            Out.Append(TEXT("\\r"));
+            break;
+        case TEXT('\t'):
+            Out.Append(TEXT("\\t"));
+            break;
+        default:
+            Out.Appendf(TEXT("\\u%04x"), static_cast<uint32>(Char));
+            break;
+        }
+    }
+    Out.Append(Value.GetData() + RunStart, Value.Len() - RunStart);
+}
+
+void FRConResponseWriter::BeginField(FStringView Name)
+{
+    FScope& Scope = Scopes.Last();
+    check(Scope.Type == EScope::Object);
+
+    if (Format == ERConResponseFormat::Json)
+    {
+        if (Scope.bHasElements)
+            Buffer.AppendChar(TEXT(','));
+        Buffer.AppendChar(TEXT('"'));
+        AppendJsonEscaped(Buffer, Name);
+        Buffer.Append(TEXT("\":"));
+    }
+    else
+    {
+        // fields of array objects indented by nesting, first one marked with dash
+        if (Scopes.Num() > 1)
+        {
+            for (int32 i = 3; i < Scopes.Num(); i += 2)
+                Buffer.Append(TEXT("  "));
+            Buffer.Append(bObjectStart ? TEXT("- ") : TEXT("  "));
+        }
+        Buffer.Append(Name);
+        Buffer.Append(TEXT(": "));
+    }
+    Scope.bHasElements = true;
+    bObjectStart = false;
+}
+
+void FRConResponseWriter::EndField()
+{
+    if (Format == ERConResponseFormat::Text)
+        Buffer.AppendChar(TEXT('\n'));
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "RConRingBuffer.h"
+
+void FRConRingBuffer::Init(int32 InCapacity)
+{
+    const uint32 Capacity = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(FMath::Max(InCapacity, 16)));
+    Data.SetNumUninitialized(Capacity);
+    Reset();
+}
+
+void FRConRingBuffer::Reset()
+{
+    Head = 0;
+    Tail = 0;
+}
+
+uint8* FRConRingBuffer::GetWriteRegion(int32& OutSize)
+{
+    const uint32 Offset = Head & GetMask();
+    OutSize = FMath::Min(GetSlack(), Data.Num() - static_cast<int32>(Offset));
+    return Data.GetData() + Offset;
+}
+
+void FRConRingBuffer::Commit(int32 Size)
+{
+    check(Size >= 0 && Size <= GetSlack());
+    Head += Size;
+}
+
+const uint8* FRConRingBuffer::GetReadRegion(int32& OutSize) const
+{
+    const uint32 Offset = Tail & GetMask();
+    OutSize = FMath::Min(Num(), Data.Num() - static_cast<int32>(Offset));
+    return Data.GetData() + Offset;
+}
+
+void FRConRingBuffer::Consume(int32 Size)
+{
+    check(Size >= 0 && Size <= Num());
+    Tail += Size;
+
+    // rewind when drained, so next writes and reads stay contiguous
+    if (IsEmpty())
+        Reset();
+}
+
+bool FRConRingBuffer::Write(const uint8* InData, int32 Size)
+{
+    if (Size > GetSlack())
+        return false;
+
+    const uint32 Offset = Head & GetMask();
+    const int32 FirstPart = FMath::Min(Size, Data.Num() - static_cast<int32>(Offset));
+    FMemory::Memcpy(Data.GetData() + Offset, InData, FirstPart);
+    FMemory::Memcpy(Data.GetData(), InData + FirstPart, Size - FirstPart);
+
+    Head += Size;
+    return true;
+}
+
+bool FRConRingBuffer::Peek(uint8* OutData, int32 Size, int32 Offset) const
+{
+    if (Offset + Size > Num())
+        return false;
+
+    const uint32 Start = (Tail + Offset) & GetMask();
+    const int32 FirstPart = FMath::Min(Size, Data.Num() - static_cast<int32>(Start));
+    FMemory::Memcpy(OutData, Data.GetData() + Start, FirstPart);
+    FMemory::Memcpy(OutData + FirstPart, Data.GetData(), Size - FirstPart);
+
+    return true;
+}
+
+const uint8* FRConRingBuffer::Linearize(int32 Size, TArray<uint8>& Scratch) const
+{
+    int32 RegionSize{};
+    const uint8* Region = GetReadRegion(RegionSize);
+    if (RegionSize >= Size)
+        return Region;
+
+    Scratch.SetNumUninitialized(Size, EAllowShrinking::No);
+    Peek(Scratch.GetData(), Size);
+    return Scratch.GetData();
+}
\ No newline at end of file
@@ -0,0 +1,285 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "RConSocketPoller.h"
+
+#include <HAL/Event.h>
+#include <HAL/PlatformProcess.h>
+#include <Sockets.h>
+
+#if RCON_WITH_EPOLL
+#include "BSDSockets/SocketsBSD.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif RCON_WITH_POLL
+#include "BSDSockets/SocketsBSD.h"
+
+#include <SocketSubsystem.h>
+
+#if !PLATFORM_WINDOWS
+#include <poll.h>
+#endif
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(RConSocketPoller, Log, Log);
+
+#if RCON_WITH_EPOLL
+
+// never collides with socket keys, those are 32 bit
+static constexpr uint64 WakeEventKey = MAX_uint64;
+
+static int GetNativeHandle(FSocket* Socket)
+{
+    // platform socket subsystem creates BSD sockets on Linux
+    return static_cast<FSocketBSD*>(Socket)->GetNativeSocket();
+}
+
+FRConSocketPoller::FRConSocketPoller()
+{
+    EpollHandle = epoll_create1(EPOLL_CLOEXEC);
+    WakeHandle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (EpollHandle < 0 || WakeHandle < 0)
+    {
+        UE_LOG(RConSocketPoller, Error, TEXT("Failed to create epoll instance, errno %d"), errno);
+        return;
+    }
+
+    epoll_event Event{};
+    Event.events = EPOLLIN;
+    Event.data.u64 = WakeEventKey;
+    epoll_ctl(EpollHandle, EPOLL_CTL_ADD, WakeHandle, &Event);
+}
+
+FRConSocketPoller::~FRConSocketPoller()
+{
+    if (WakeHandle >= 0)
+        close(WakeHandle);
+    if (EpollHandle >= 0)
+        close(EpollHandle);
+}
+
+bool FRConSocketPoller::IsValid() const
+{
+    return EpollHandle >= 0 && WakeHandle >= 0;
+}
+
+bool FRConSocketPoller::Add(FSocket* Socket, uint32 Key)
+{
+    epoll_event Event{};
+    Event.events = EPOLLIN | EPOLLRDHUP;
+    Event.data.u64 = Key;
+
+    const bool bAdded = epoll_ctl(EpollHandle, EPOLL_CTL_ADD, GetNativeHandle(Socket), &Event) == 0;
+    UE_CLOG(!bAdded, RConSocketPoller, Error, TEXT("Failed to add socket %u to epoll, errno %d"), Key, errno);
+    return bAdded;
+}
+
+void FRConSocketPoller::Remove(FSocket* Socket, uint32 Key)
+{
+    epoll_ctl(EpollHandle, EPOLL_CTL_DEL, GetNativeHandle(Socket), nullptr);
+}
+
+bool FRConSocketPoller::Modify(FSocket* Socket, uint32 Key, bool bRead, bool bWrite)
+{
+    epoll_event Event{};
+    Event.events = (bRead ? EPOLLIN | EPOLLRDHUP : 0) | (bWrite ? EPOLLOUT : 0);
+    Event.data.u64 = Key;
+
+    const bool bModified = epoll_ctl(EpollHandle, EPOLL_CTL_MOD, GetNativeHandle(Socket), &Event) == 0;
+    UE_CLOG(!bModified, RConSocketPoller, Error, TEXT("Failed to modify socket %u in epoll, errno %d"), Key, errno);
+    return bModified;
+}
+
+void FRConSocketPoller::Wait(uint32 WaitTime, TArray<uint32>& OutReadyKeys)
+{
+    epoll_event Events[64];
+    const int32 NumEvents = epoll_wait(EpollHandle, Events, UE_ARRAY_COUNT(Events), static_cast<int>(WaitTime));
+
+    for (int32 i = 0; i < NumEvents; ++i)
+    {
+        if (Events[i].data.u64 == WakeEventKey)
+        {
+            uint64 Counter{};
+            const ssize_t BytesRead = read(WakeHandle, &Counter, sizeof(Counter));
+            (void)BytesRead;
+            continue;
+        }
+        OutReadyKeys.Add(static_cast<uint32>(Events[i].data.u64));
+    }
+}
+
+void FRConSocketPoller::Wake()
+{
+    const uint64 Increment = 1;
+    const ssize_t BytesWritten = write(WakeHandle, &Increment, sizeof(Increment));
+    (void)BytesWritten;
+}
+
+#elif RCON_WITH_POLL
+
+struct FRConSocketPoller::FPollSet
+{
+    // first entry is wake socket, the rest matches Keys one to one
+    TArray<pollfd> Fds{};
+    TArray<uint32> Keys{};
+};
+
+static SOCKET GetNativeHandle(FSocket* Socket)
+{
+    // platform socket subsystems create BSD sockets on Windows and Mac
+    return static_cast<FSocketBSD*>(Socket)->GetNativeSocket();
+}
+
+FRConSocketPoller::FRConSocketPoller()
+    : PollSet{MakeUnique<FPollSet>()}
+{
+    ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+    WakeAddress = SocketSubsystem->CreateInternetAddr(FNetworkProtocolTypes::IPv4);
+    WakeAddress->SetLoopbackAddress();
+    WakeAddress->SetPort(0);
+
+    WakeSocket = SocketSubsystem->CreateSocket(NAME_DGram, TEXT("RConSocketPollerWake"), FNetworkProtocolTypes::IPv4);
+    if (!WakeSocket || !WakeSocket->SetNonBlocking() || !WakeSocket->Bind(*WakeAddress))
+    {
+        UE_LOG(RConSocketPoller, Error, TEXT("Failed to create wake socket"));
+        if (WakeSocket)
+            SocketSubsystem->DestroySocket(WakeSocket);
+        WakeSocket = nullptr;
+        return;
+    }
+    // ephemeral port picked by bind
+    WakeSocket->GetAddress(*WakeAddress);
+
+    pollfd& WakeFd = PollSet->Fds.AddZeroed_GetRef();
+    WakeFd.fd = GetNativeHandle(WakeSocket);
+    WakeFd.events = POLLIN;
+}
+
+FRConSocketPoller::~FRConSocketPoller()
+{
+    if (WakeSocket)
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(WakeSocket);
+}
+
+bool FRConSocketPoller::IsValid() const
+{
+    return WakeSocket != nullptr;
+}
+
+bool FRConSocketPoller::Add(FSocket* Socket, uint32 Key)
+{
+    pollfd& Fd = PollSet->Fds.AddZeroed_GetRef();
+    Fd.fd = GetNativeHandle(Socket);
+    Fd.events = POLLIN;
+    PollSet->Keys.Add(Key);
+    return true;
+}
+
+void FRConSocketPoller::Remove(FSocket* Socket, uint32 Key)
+{
+    const int32 Index = PollSet->Keys.Find(Key);
+    if (Index == INDEX_NONE)
+        return;
+
+    // both arrays swap their last element in, so entries stay paired
+    PollSet->Keys.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+    PollSet->Fds.RemoveAtSwap(Index + 1, 1, EAllowShrinking::No);
+}
+
+bool FRConSocketPoller::Modify(FSocket* Socket, uint32 Key, bool bRead, bool bWrite)
+{
+    const int32 Index = PollSet->Keys.Find(Key);
+    if (Index == INDEX_NONE)
+        return false;
+
+    PollSet->Fds[Index + 1].events = (bRead ? POLLIN : 0) | (bWrite ? POLLOUT : 0);
+    return true;
+}
+
+void FRConSocketPoller::Wait(uint32 WaitTime, TArray<uint32>& OutReadyKeys)
+{
+    TArray<pollfd>& Fds = PollSet->Fds;
+#if PLATFORM_WINDOWS
+    const int32 NumReady = WSAPoll(Fds.GetData(), static_cast<ULONG>(Fds.Num()), static_cast<INT>(WaitTime));
+#else
+    const int32 NumReady = poll(Fds.GetData(), static_cast<nfds_t>(Fds.Num()), static_cast<int>(WaitTime));
+#endif
+    if (NumReady <= 0)
+        return;
+
+    if (Fds[0].revents != 0)
+    {
+        // any number of wakes collapse into one
+        uint8 Byte{};
+        int32 BytesRead{};
+        while (WakeSocket->Recv(&Byte, sizeof(Byte), BytesRead) && BytesRead > 0)
+        {
+        }
+    }
+
+    // hang up and errors reported too, following Recv finds out what happened
+    for (int32 i = 1; i < Fds.Num(); ++i)
+    {
+        if (Fds[i].revents != 0)
+            OutReadyKeys.Add(PollSet->Keys[i - 1]);
+    }
+}
+
+void FRConSocketPoller::Wake()
+{
+    const uint8 Byte{};
+    int32 BytesSent{};
+    WakeSocket->SendTo(&Byte, sizeof(Byte), BytesSent, *WakeAddress);
+}
+
+#else
+
+FRConSocketPoller::FRConSocketPoller()
+    : WakeEvent{FPlatformProcess::GetSynchEventFromPool()}
+{
+}
+
+FRConSocketPoller::~FRConSocketPoller()
+{
+    FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+bool FRConSocketPoller::IsValid() const
+{
+    return WakeEvent != nullptr;
+}
+
+bool FRConSocketPoller::Add(FSocket* Socket, uint32 Key)
+{
+    Keys.Add(Key);
+    return true;
+}
+
+void FRConSocketPoller::Remove(FSocket* Socket, uint32 Key)
+{
+    Keys.RemoveSingleSwap(Key, EAllowShrinking::No);
+}
+
+bool FRConSocketPoller::Modify(FSocket* Socket, uint32 Key, bool bRead, bool bWrite)
+{
+    // every socket reported anyway
+    return true;
+}
+
+void FRConSocketPoller::Wait(uint32 WaitTime, TArray<uint32>& OutReadyKeys)
+{
+    if (WaitTime > 0)
+        WakeEvent->Wait(WaitTime);
+
+    OutReadyKeys.Append(Keys);
+}
+
+void FRConSocketPoller::Wake()
+{
+    WakeEvent->Trigger();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,263 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include <Math/RandomStream.h>
+#include <Misc/AutomationTest.h>
+
+#include "RConCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+    // frame with arbitrary size field and raw body bytes, to build packets SerializePacket never would
+    TArray<uint8> MakeFrame(int32 SizeField, int32 Id, ERConPacketType Type, TArrayView<const uint8> BodyBytes, int32 NumTerminators = 2)
+    {
+        TArray<uint8> Frame{};
+        const int32 Header[3] = {INTEL_ORDER32(SizeField), INTEL_ORDER32(Id), INTEL_ORDER32(static_cast<int32>(Type))};
+        Frame.Append(reinterpret_cast<const uint8*>(Header), sizeof(Header));
+        Frame.Append(BodyBytes.GetData(), BodyBytes.Num());
+        Frame.AddZeroed(NumTerminators);
+        return Frame;
+    }
+
+    // frame with size field matching its length
+    TArray<uint8> MakeFrame(int32 Id, ERConPacketType Type, TArrayView<const uint8> BodyBytes)
+    {
+        const int32 SizeField = CRConMinPacketSize + BodyBytes.Num();
+        return MakeFrame(SizeField, Id, Type, BodyBytes);
+    }
+
+    TArray<uint8> MakeBytes(std::initializer_list<uint8> Bytes)
+    {
+        return TArray<uint8>(Bytes);
+    }
+
+    bool Decode(const TArray<uint8>& Frame, FRConPacket& OutPacket, int32 MaxPacketSize = CRConMaxPacketSize)
+    {
+        return FRConPacket::DeserializePacket(Frame.GetData(), Frame.Num(), OutPacket, MaxPacketSize);
+    }
+} // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRConPacketFramingTest, "RCon.Packet.Framing", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FRConPacketFramingTest::RunTest(const FString& Parameters)
+{
+    FRConPacket Packet{};
+    const TArray<uint8> Body = MakeBytes({'s', 't', 'a', 't', ' ', 'f', 'p', 's'});
+
+    const TArray<uint8> Valid = MakeFrame(7, ERConPacketType::ExecCommand, Body);
+    TestTrue(TEXT("valid packet decoded"), Decode(Valid, Packet));
+    TestEqual(TEXT("id"), Packet.Id, 7);
+    TestTrue(TEXT("type"), Packet.Type == ERConPacketType::ExecCommand);
+    TestEqual(TEXT("body"), Packet.Body, FString(TEXT("stat fps")));
+
+    const TArray<uint8> Empty = MakeFrame(1, ERConPacketType::Auth, {});
+    TestTrue(TEXT("empty body decoded"), Decode(Empty, Packet));
+    TestTrue(TEXT("empty body"), Packet.Body.IsEmpty());
+
+    // every prefix of valid packet is truncated
+    for (int32 Size = 0; Size < Valid.Num(); ++Size)
+        TestFalse(*FString::Printf(TEXT("truncated to %d bytes"), Size), FRConPacket::DeserializePacket(Valid.GetData(), Size, Packet));
+
+    TestFalse(TEXT("size field bigger than data"), Decode(MakeFrame(CRConMinPacketSize + Body.Num() + 1, 1, ERConPacketType::ExecCommand, Body), Packet));
+    TestFalse(TEXT("size field smaller than data"), Decode(MakeFrame(CRConMinPacketSize + Body.Num() - 1, 1, ERConPacketType::ExecCommand, Body), Packet));
+    TestFalse(TEXT("size field below minimum"), Decode(MakeFrame(CRConMinPacketSize - 1, 1, ERConPacketType::ExecCommand, {}, 1), Packet));
+    TestFalse(TEXT("negative size field"), Decode(MakeFrame(-1, 1, ERConPacketType::ExecCommand, Body), Packet));
+    TestFalse(TEXT("size field above max"), Decode(Valid, Packet, CRConMinPacketSize + Body.Num() - 1));
+    TestTrue(TEXT("size field equal to max"), Decode(Valid, Packet, CRConMinPacketSize + Body.Num()));
+
+    TArray<uint8> Unterminated = MakeFrame(CRConMinPacketSize + Body.Num(), 1, ERConPacketType::ExecCommand, Body, 0);
+    Unterminated.Add('x');
+    Unterminated.Add('y');
+    TestFalse(TEXT("missing terminator"), Decode(Unterminated, Packet));
+
+    // single terminator some clients send, size field counts it
+    const TArray<uint8> SingleTerminator = MakeFrame(CRConMinPacketSize + Body.Num() - 1, 1, ERConPacketType::ExecCommand, Body, 1);
+    TestTrue(TEXT("single terminator decoded"), Decode(SingleTerminator, Packet));
+    TestEqual(TEXT("single terminator body"), Packet.Body, FString(TEXT("stat fps")));
+
+    // null inside body ends it
+    const TArray<uint8> EmbeddedNull = MakeFrame(1, ERConPacketType::ExecCommand, MakeBytes({'a', 'b', 0, 'c'}));
+    TestTrue(TEXT("embedded null decoded"), Decode(EmbeddedNull, Packet));
+    TestEqual(TEXT("embedded null body"), Packet.Body, FString(TEXT("ab")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRConPacketUtf8Test, "RCon.Packet.Utf8", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FRConPacketUtf8Test::RunTest(const FString& Parameters)
+{
+    FRConPacket Packet{};
+
+    struct FValidCase
+    {
+        const TCHAR* Name;
+        TArray<uint8> Bytes;
+        FString Expected;
+    };
+    const FValidCase ValidCases[] = {
+        {TEXT("two byte"), MakeBytes({'c', 'a', 'f', 0xC3, 0xA9}), FString(TEXT("caf\u00e9"))},
+        {TEXT("three byte"), MakeBytes({0xE2, 0x82, 0xAC}), FString(TEXT("\u20ac"))},
+        {TEXT("four byte"), MakeBytes({0xF0, 0x9F, 0x98, 0x80}), FString(TEXT("\U0001F600"))},
+        {TEXT("largest codepoint"), MakeBytes({0xF4, 0x8F, 0xBF, 0xBF}), FString(TEXT("\U0010FFFF"))},
+    };
+    for (const FValidCase& Case : ValidCases)
+    {
+        TestTrue(*FString::Printf(TEXT("%s decoded"), Case.Name), Decode(MakeFrame(1, ERConPacketType::ExecCommand, Case.Bytes), Packet));
+        TestEqual(*FString::Printf(TEXT("%s body"), Case.Name), Packet.Body, Case.Expected);
+    }
+
+    struct FInvalidCase
+    {
+        const TCHAR* Name;
+        TArray<uint8> Bytes;
+    };
+    const FInvalidCase InvalidCases[] = {
+        {TEXT("invalid lead byte"), MakeBytes({'a', 0xFF, 'b'})},
+        {TEXT("five byte lead"), MakeBytes({0xF8, 0x88, 0x80, 0x80, 0x80})},
+        {TEXT("stray continuation"), MakeBytes({'a', 0x80, 'b'})},
+        {TEXT("truncated at end"), MakeBytes({'a', 0xE2, 0x82})},
+        {TEXT("truncated by ascii"), MakeBytes({0xE2, 'a', 0xAC})},
+        {TEXT("overlong two byte"), MakeBytes({0xC0, 0xAF})},
+        {TEXT("overlong three byte"), MakeBytes({0xE0, 0x80, 0xAF})},
+        {TEXT("overlong four byte"), MakeBytes({0xF0, 0x80, 0x80, 0xAF})},
+        {TEXT("surrogate"), MakeBytes({0xED, 0xA0, 0x80})},
+        {TEXT("above max codepoint"), MakeBytes({0xF4, 0x90, 0x80, 0x80})},
+    };
+    for (const FInvalidCase& Case : InvalidCases)
+        TestFalse(Case.Name, Decode(MakeFrame(1, ERConPacketType::ExecCommand, Case.Bytes), Packet));
+
+    // non-ASCII and null bytes at every position of bodies longer than fast path blocks,
+    // so both block scan and scalar tail have to find them
+    constexpr int32 BodyLength = 48;
+    for (int32 Position = 0; Position < BodyLength; ++Position)
+    {
+        TArray<uint8> Bytes{};
+        Bytes.Init('a', BodyLength);
+        Bytes.Insert(MakeBytes({0xC3, 0xA9}), Position);
+
+        FString Expected = FString::ChrN(Position, TEXT('a')) + TEXT("\u00e9") + FString::ChrN(BodyLength - Position, TEXT('a'));
+        TestTrue(*FString::Printf(TEXT("non-ASCII at %d decoded"), Position), Decode(MakeFrame(1, ERConPacketType::ExecCommand, Bytes), Packet));
+        TestEqual(*FString::Printf(TEXT("non-ASCII at %d body"), Position), Packet.Body, Expected);
+
+        Bytes.Init('a', BodyLength);
+        Bytes[Position] = 0;
+        TestTrue(*FString::Printf(TEXT("null at %d decoded"), Position), Decode(MakeFrame(1, ERConPacketType::ExecCommand, Bytes), Packet));
+        TestEqual(*FString::Printf(TEXT("null at %d body"), Position), Packet.Body, FString::ChrN(Position, TEXT('a')));
+
+        Bytes.Init('a', BodyLength);
+        Bytes[Position] = 0x80;
+        TestFalse(*FString::Printf(TEXT("stray continuation at %d"), Position), Decode(MakeFrame(1, ERConPacketType::ExecCommand, Bytes), Packet));
+    }
+
+    // whatever SerializePacket writes decodes back
+    const FString RoundTrip = FString::ChrN(40, TEXT('x')) + TEXT("\u00e9\u20ac\U0001F600") + FString::ChrN(20, TEXT('y'));
+    const TArray<uint8> Serialized = FRConPacket::SerializePacket(FRConPacket{3, ERConPacketType::ResponseValue, RoundTrip});
+    TestTrue(TEXT("round trip decoded"), Decode(Serialized, Packet));
+    TestEqual(TEXT("round trip body"), Packet.Body, RoundTrip);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRConPacketStreamTest, "RCon.Packet.Stream", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FRConPacketStreamTest::RunTest(const FString& Parameters)
+{
+    TArray<FRConPacket> Packets{};
+    int32 NumPackets{};
+
+    TArray<uint8> Stream{};
+    Stream.Append(MakeFrame(1, ERConPacketType::Auth, MakeBytes({'p', 'w'})));
+    Stream.Append(MakeFrame(2, ERConPacketType::ExecCommand, MakeBytes({'h', 'e', 'l', 'p'})));
+    // bad UTF-8 is skipped, stream stays framed
+    Stream.Append(MakeFrame(3, ERConPacketType::ExecCommand, MakeBytes({0xC0, 0xAF})));
+    Stream.Append(MakeFrame(4, ERConPacketType::ExecCommand, {}));
+    const int32 WholeSize = Stream.Num();
+
+    const TArray<uint8> Tail = MakeFrame(5, ERConPacketType::ExecCommand, MakeBytes({'t', 'a', 'i', 'l'}));
+    Stream.Append(Tail.GetData(), Tail.Num() - 1);
+
+    TestEqual(TEXT("consumed whole packets"), FRConPacket::DeserializePackets(Stream.GetData(), Stream.Num(), Packets, NumPackets), WholeSize);
+    TestEqual(TEXT("decoded packets"), NumPackets, 3);
+    if (NumPackets == 3)
+    {
+        TestEqual(TEXT("first id"), Packets[0].Id, 1);
+        TestEqual(TEXT("first body"), Packets[0].Body, FString(TEXT("pw")));
+        TestEqual(TEXT("second id"), Packets[1].Id, 2);
+        TestEqual(TEXT("second body"), Packets[1].Body, FString(TEXT("help")));
+        TestEqual(TEXT("third id"), Packets[2].Id, 4);
+        TestTrue(TEXT("third body"), Packets[2].Body.IsEmpty());
+    }
+
+    // tail alone, completed later
+    TestEqual(TEXT("partial tail not consumed"), FRConPacket::DeserializePackets(Stream.GetData() + WholeSize, Stream.Num() - WholeSize, Packets, NumPackets), 0);
+    TestEqual(TEXT("partial tail not decoded"), NumPackets, 0);
+    TestEqual(TEXT("partial size field not consumed"), FRConPacket::DeserializePackets(Tail.GetData(), CRConPacketSizeFieldLength - 1, Packets, NumPackets), 0);
+    TestEqual(TEXT("completed tail consumed"), FRConPacket::DeserializePackets(Tail.GetData(), Tail.Num(), Packets, NumPackets), Tail.Num());
+    TestEqual(TEXT("completed tail decoded"), NumPackets, 1);
+
+    // framing lost, nothing after it can be trusted
+    TArray<uint8> Broken = MakeFrame(1, ERConPacketType::ExecCommand, {});
+    Broken.Append(MakeFrame(CRConMinPacketSize - 1, 2, ERConPacketType::ExecCommand, {}, 1));
+    TestEqual(TEXT("size below minimum"), FRConPacket::DeserializePackets(Broken.GetData(), Broken.Num(), Packets, NumPackets), INDEX_NONE);
+
+    const TArray<uint8> Oversized = MakeFrame(CRConMaxPacketSize + 1, 1, ERConPacketType::ExecCommand, {});
+    TestEqual(TEXT("size above max"), FRConPacket::DeserializePackets(Oversized.GetData(), Oversized.Num(), Packets, NumPackets), INDEX_NONE);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRConPacketMutationTest, "RCon.Packet.Mutation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FRConPacketMutationTest::RunTest(const FString& Parameters)
+{
+    // fixed seed, failures reproduce. Meant to run under address sanitizer as well
+    FRandomStream Random{1234};
+
+    TArray<uint8> Seed{};
+    FRConPacket::SerializePacket(Seed, 1, ERConPacketType::Auth, TEXT("password"));
+    FRConPacket::SerializePacket(Seed, 2, ERConPacketType::ExecCommand, FString::ChrN(40, TEXT('a')) + TEXT("\u00e9\u20ac\U0001F600"));
+    FRConPacket::SerializePacket(Seed, 3, ERConPacketType::ExecCommand, TEXT(""));
+
+    TArray<FRConPacket> Packets{};
+    TArray<uint8> Input{};
+    for (int32 Iteration = 0; Iteration < 20000; ++Iteration)
+    {
+        Input = Seed;
+        const int32 NumMutations = Random.RandRange(1, 8);
+        for (int32 i = 0; i < NumMutations; ++i)
+            Input[Random.RandRange(0, Input.Num() - 1)] = static_cast<uint8>(Random.RandRange(0, 255));
+        Input.SetNum(Random.RandRange(0, Input.Num()));
+
+        // exact size copy, so reads past the end are caught by sanitizer
+        const TArray<uint8> Exact(Input.GetData(), Input.Num());
+
+        // mutated size fields may frame any number of packets, only bounds are checked
+        constexpr int32 MaxPacketSize = 64;
+        int32 NumPackets{};
+        const int32 Consumed = FRConPacket::DeserializePackets(Exact.GetData(), Exact.Num(), Packets, NumPackets, MaxPacketSize);
+        if (Consumed > Exact.Num() || NumPackets > Packets.Num())
+        {
+            AddError(FString::Printf(TEXT("Iteration %d consumed %d of %d bytes into %d packets"), Iteration, Consumed, Exact.Num(), NumPackets));
+            return false;
+        }
+
+        for (int32 i = 0; i < NumPackets; ++i)
+        {
+            const int32 PacketSize = CRConMinPacketSize + FRConPacket::GetBodyUtf8Length(Packets[i].Body);
+            if (PacketSize > MaxPacketSize)
+            {
+                AddError(FString::Printf(TEXT("Iteration %d decoded packet of size %d, above max of %d"), Iteration, PacketSize, MaxPacketSize));
+                return false;
+            }
+        }
+
+        FRConPacket Packet{};
+        FRConPacket::DeserializePacket(Exact.GetData(), Exact.Num(), Packet, MaxPacketSize);
+    }
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,189 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <Async/Future.h>
+#include <Containers/Queue.h>
+#include <CoreMinimal.h>
+
+#include <atomic>
+
+#include "RConCommon.h"
+#include "RConRingBuffer.h"
+
+class FRConSocketPoller;
+class FRunnableThread;
+class FSocket;
+
+// Source RCON client, keeps any number of persistent connections with many requests in flight on each.
+// Responses matched to requests by packet id, multi-packet responses collected using empty packet terminator trick.
+// Socket work runs on own thread, public functions safe to call from any thread.
+class RCONCOMMON_API FRConClient final
+{
+public:
+    FRConClient() = default;
+    FRConClient(const FRConClient&) = delete;
+    FRConClient(FRConClient&&) = delete;
+    ~FRConClient();
+
+    struct FSettings
+    {
+        FSettings()
+            : WaitTime{100}
+            , RequestTimeout{30.0}
+            , ReconnectDelay{5.0}
+            , MaxPacketSize{CRConMinPacketSize + CRConMaxResponseBodySize}
+            , bUseThread{true}
+        {
+        }
+
+        // max time in milliseconds client thread waits for socket events, before checking stop request
+        // capped to 1 on platforms without socket readiness backend, see FRConSocketPoller
+        uint32 WaitTime;
+
+        // seconds to wait for connection or full response, before request fails
+        double RequestTimeout;
+
+        // seconds between attempts to restore lost connection, zero to not reconnect
+        double ReconnectDelay;
+
+        // packets with bigger size field considered malformed and drop connection
+        // default fits response chunks of servers splitting them by CRConMaxResponseBodySize
+        int32 MaxPacketSize;
+
+        // run socket work on own thread, otherwise Tick() should be called
+        bool bUseThread;
+    };
+
+    struct FResponse
+    {
+        bool bSuccess{};
+        // response body, or reason of failure
+        FString Body{};
+    };
+
+    bool Start(const FSettings& InSettings = FSettings());
+    void Tick();
+    void Stop();
+
+    bool IsStarted() const { return bStarted; }
+
+    // open persistent connection, connect and authentication happen in background
+    // @param Address IP address of server
+    // @return id of connection for SendCommand, zero if client is not started
+    uint32 Connect(const FString& Address, uint16 Port, const FString& Password);
+
+    // close connection, its requests fail
+    void Disconnect(uint32 ConnectionId);
+
+    // commands sent before connection is ready wait for it, up to RequestTimeout
+    // @return future set once full response received, or request failed
+    TFuture<FResponse> SendCommand(uint32 ConnectionId, FString Command);
+
+private:
+    class FClientRunnable;
+
+    enum class EConnectionState : uint8
+    {
+        Disconnected,
+        Connecting,
+        Authenticating,
+        Ready
+    };
+
+    struct FRequest
+    {
+        TPromise<FResponse> Promise{};
+        FString Command{};
+        // response packets appended together
+        FString Body{};
+        double Deadline{};
+        bool bReceivedData{};
+        // terminator sent, but not mirrored back yet
+        bool bTerminatorPending{};
+    };
+
+    struct FConnection
+    {
+        uint32 Id{};
+        FString Address{};
+        uint16 Port{};
+        FString Password{};
+
+        EConnectionState State{};
+        FSocket* Socket{};
+        bool bReconnect{};
+        double NextConnectTime{};
+        double ConnectDeadline{};
+
+        // command packets use even ids, terminators the following odd ones
+        int32 NextPacketId{};
+
+        TArray<uint8> SendBuffer{};
+        int32 SendOffset{};
+        FRConRingBuffer RecvBuffer{};
+        TArray<uint8> RecvScratch{};
+
+        // sent and waiting for response, by packet id
+        TMap<int32, FRequest> Requests{};
+        // waiting for connection to become ready
+        TArray<FRequest> WaitingRequests{};
+    };
+
+    enum class ECommandType : uint8
+    {
+        Connect,
+        Disconnect,
+        Send
+    };
+
+    // passed from caller thread to client thread
+    struct FCommand
+    {
+        ECommandType Type{};
+        uint32 ConnectionId{};
+        FString Address{};
+        uint16 Port{};
+        // password for connect, command body for send
+        FString Body{};
+        // send only, queue default constructs commands and unfulfilled promise asserts once destroyed
+        TOptional<TPromise<FResponse>> Promise{};
+    };
+
+    // auth packet is the only one with odd id, that is not a terminator
+    static constexpr int32 AuthPacketId = 1;
+
+    void TickNetwork(uint32 WaitTime);
+    void ProcessCommands();
+    void UpdateConnection(FConnection& Connection, double Now);
+
+    void OpenSocket(FConnection& Connection, double Now);
+    void CloseConnection(FConnection& Connection, const TCHAR* Reason, bool bReconnect);
+
+    void SendRequest(FConnection& Connection, FRequest&& Request);
+    void SendTerminator(FConnection& Connection, int32 PacketId, FRequest& Request);
+
+    void ProcessIncoming(FConnection& Connection);
+    void ProcessReceivedPackets(FConnection& Connection);
+    void ProcessPacket(FConnection& Connection, FRConPacket& Packet);
+    void ProcessOutgoing(FConnection& Connection);
+
+    static void FailRequest(FRequest& Request, const TCHAR* Reason);
+
+    FSettings Settings{};
+
+    std::atomic<uint32> LastConnectionId{};
+
+    TQueue<FCommand, EQueueMode::Mpsc> Commands{};
+
+    // client thread only
+    TMap<uint32, TUniquePtr<FConnection>> Connections{};
+
+    TUniquePtr<FRConSocketPoller> Poller{};
+    TArray<uint32> ReadyKeys{};
+
+    TUniquePtr<FClientRunnable> ClientRunnable{};
+    TUniquePtr<FRunnableThread> ClientThread{};
+
+    bool bStarted{};
+};
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <Containers/StringView.h>
 #include <CoreMinimal.h>
 #include <Modules/ModuleManager.h>
 
@@ -15,6 +16,18 @@ public:
 
 const int32 CRConBasePacketSize = 12;
 
+// leading size field, not included in its own value
+const int32 CRConPacketSizeFieldLength = 4;
+
+// smallest value of packet size field: id, type and two null terminators
+const int32 CRConMinPacketSize = 10;
+
+// largest value of packet size field allowed by Source RCON protocol
+const int32 CRConMaxPacketSize = 4096;
+
+// largest response body most clients accept in a single packet, bigger responses split into several
+const int32 CRConMaxResponseBodySize = 4096;
+
 enum class ERConPacketType : int32
 {
     ResponseValue = 0,
@@ -34,5 +47,30 @@ struct RCONCOMMON_API FRConPacket
 
     static TArray<uint8> SerializePacket(const FRConPacket& Packet);
 
-    static TPair<bool, FRConPacket> DeserializePacket(uint8* Data, int32 Size);
+    // @return full size of serialized packet (including size field) for body of given UTF-8 length
+    static int32 GetSerializedSize(int32 BodyUtf8Length) { return CRConBasePacketSize + BodyUtf8Length + 2; }
+
+    // @return UTF-8 length of body, that would be written by SerializePacket
+    static int32 GetBodyUtf8Length(FStringView Body);
+
+    // @return number of characters from start of the body, that fit into MaxUtf8Length once converted
+    static int32 GetBodyChunkLength(FStringView Body, int32 MaxUtf8Length);
+
+    // append serialized packet to OutData, body converted directly into it
+    static void SerializePacket(TArray<uint8>& OutData, int32 Id, ERConPacketType Type, FStringView Body);
+
+    // serialize packet into caller provided memory
+    // @return bytes written, or 0 if Capacity is not enough
+    static int32 SerializePacket(uint8* OutData, int32 Capacity, int32 Id, ERConPacketType Type, FStringView Body);
+
+    // decode single packet, Data has to hold exactly one, including size field
+    // body decoded into OutPacket.Body reusing its allocation
+    // @return false if declared size does not match Size or exceeds MaxPacketSize, packet is not terminated or body is not valid UTF-8
+    static bool DeserializePacket(const uint8* Data, int32 Size, FRConPacket& OutPacket, int32 MaxPacketSize = CRConMaxPacketSize);
+
+    // decode all whole packets from the start of Data into OutPackets, partial packet at the end left for later
+    // OutPackets is reused, elements beyond OutNumPackets keep their allocations for next call
+    // packets that failed to decode are skipped
+    // @return bytes consumed, or INDEX_NONE if packet with invalid size found and stream could not be framed anymore
+    static int32 DeserializePackets(const uint8* Data, int32 Size, TArray<FRConPacket>& OutPackets, int32& OutNumPackets, int32 MaxPacketSize = CRConMaxPacketSize);
 };
\ No newline at end of file
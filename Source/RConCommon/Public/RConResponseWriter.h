@@ -0,0 +1,69 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <CoreMinimal.h>
+
+enum class ERConResponseFormat : uint8
+{
+    // human readable "name: value" lines
+    Text,
+    // compact JSON object, for machine consumers
+    Json
+};
+
+// Builds response from typed fields, formatted as text lines or JSON
+// Fields written into root object, or into current object of array. Arrays hold only objects
+class RCONCOMMON_API FRConResponseWriter
+{
+public:
+    explicit FRConResponseWriter(ERConResponseFormat InFormat = ERConResponseFormat::Text) { Reset(InFormat); }
+
+    // start new response, reusing allocation of previous ones
+    void Reset(ERConResponseFormat InFormat);
+
+    ERConResponseFormat GetFormat() const { return Format; }
+
+    void WriteString(FStringView Name, FStringView Value);
+    void WriteInt(FStringView Name, int64 Value);
+    void WriteDouble(FStringView Name, double Value);
+    void WriteBool(FStringView Name, bool Value);
+
+    void BeginArray(FStringView Name);
+    void EndArray();
+
+    // object element of current array
+    void BeginObject();
+    void EndObject();
+
+    // closes what is left open
+    // @return serialized response, valid until next Reset. Copy it out to keep it
+    const FString& Finish();
+
+    // append Value with JSON special characters escaped, without surrounding quotes
+    static void AppendJsonEscaped(FString& Out, FStringView Value);
+
+private:
+    enum class EScope : uint8
+    {
+        Object,
+        Array
+    };
+
+    struct FScope
+    {
+        EScope Type;
+        // JSON needs separator before next element
+        bool bHasElements;
+    };
+
+    // name and separator, ready for value to follow
+    void BeginField(FStringView Name);
+    void EndField();
+
+    FString Buffer{};
+    TArray<FScope, TInlineAllocator<8>> Scopes{};
+    ERConResponseFormat Format{};
+    // text format marks first field of array object with dash
+    bool bObjectStart{};
+};
@@ -0,0 +1,49 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <CoreMinimal.h>
+
+// Fixed capacity byte ring, storage allocated once and reused for the whole connection lifetime
+class RCONCOMMON_API FRConRingBuffer
+{
+public:
+    FRConRingBuffer() = default;
+
+    // allocate storage, capacity rounded up to power of two
+    void Init(int32 InCapacity);
+
+    // drop all data, storage is kept
+    void Reset();
+
+    int32 Num() const { return static_cast<int32>(Head - Tail); }
+    int32 GetCapacity() const { return Data.Num(); }
+    int32 GetSlack() const { return GetCapacity() - Num(); }
+    bool IsEmpty() const { return Head == Tail; }
+
+    // contiguous free region at write position, should be followed by Commit
+    uint8* GetWriteRegion(int32& OutSize);
+    void Commit(int32 Size);
+
+    // contiguous data region at read position, should be followed by Consume
+    const uint8* GetReadRegion(int32& OutSize) const;
+    void Consume(int32 Size);
+
+    // @return false if not enough slack, nothing written in that case
+    bool Write(const uint8* InData, int32 Size);
+
+    // copy data without consuming it. @return false if not enough data
+    bool Peek(uint8* OutData, int32 Size, int32 Offset = 0) const;
+
+    // @return pointer to Size bytes at read position, copied to Scratch only when they wrap around
+    const uint8* Linearize(int32 Size, TArray<uint8>& Scratch) const;
+
+private:
+    uint32 GetMask() const { return static_cast<uint32>(Data.Num()) - 1; }
+
+    TArray<uint8> Data{};
+
+    // free running positions, wrapped with mask on access
+    uint32 Head{};
+    uint32 Tail{};
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <CoreMinimal.h>
+
+class FEvent;
+class FInternetAddr;
+class FSocket;
+
+// Socket readiness notifications, so only sockets with events get touched.
+// Backed by epoll on Linux and poll on Windows and Mac. Other platforms have no readiness backend,
+// there every registered socket reported on each wait, leaving it to a single non-blocking Recv/Accept to find out if there is anything.
+class RCONCOMMON_API FRConSocketPoller final
+{
+public:
+    FRConSocketPoller();
+    ~FRConSocketPoller();
+
+    FRConSocketPoller(const FRConSocketPoller&) = delete;
+    FRConSocketPoller& operator=(const FRConSocketPoller&) = delete;
+
+    bool IsValid() const;
+
+    // false when Wait only sleeps and reports every socket, long waits then delay incoming data
+    static constexpr bool HasReadinessBackend()
+    {
+        return RCON_WITH_EPOLL || RCON_WITH_POLL;
+    }
+
+    // start watching socket for read readiness, Key reported back from Wait
+    bool Add(FSocket* Socket, uint32 Key);
+    void Remove(FSocket* Socket, uint32 Key);
+
+    // change readiness socket is watched for, errors and hang up reported either way
+    // write readiness lets wait end as soon as full socket buffer frees up, instead of retrying after WaitTime
+    bool Modify(FSocket* Socket, uint32 Key, bool bRead, bool bWrite);
+
+    // block up to WaitTime milliseconds until any socket is ready or Wake called
+    void Wait(uint32 WaitTime, TArray<uint32>& OutReadyKeys);
+
+    // interrupt Wait, safe to call from any thread
+    void Wake();
+
+private:
+#if RCON_WITH_EPOLL
+    int32 EpollHandle{-1};
+    int32 WakeHandle{-1};
+#elif RCON_WITH_POLL
+    struct FPollSet;
+    TUniquePtr<FPollSet> PollSet{};
+    // loopback UDP socket sending to itself, wakes poll the same way as any other socket
+    FSocket* WakeSocket{};
+    TSharedPtr<FInternetAddr> WakeAddress{};
+#else
+    TArray<uint32> Keys{};
+    FEvent* WakeEvent{};
+#endif
+};
\ No newline at end of file
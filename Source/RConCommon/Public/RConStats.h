@@ -0,0 +1,10 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <ProfilingDebugging/CpuProfilerTrace.h>
+#include <Stats/Stats.h>
+
+// shown with 'stat rcon', cycle stats and counters declared next to code they measure
+DECLARE_STATS_GROUP(TEXT("RCon"), STATGROUP_RCon, STATCAT_Advanced);
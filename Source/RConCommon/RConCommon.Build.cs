@@ -1,5 +1,6 @@
 // Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
 
+using System.IO;
 using UnrealBuildTool;
 
 public class RConCommon : ModuleRules
@@ -22,8 +23,18 @@ public class RConCommon : ModuleRules
                 "Engine",
                 "Slate",
                 "SlateCore",
+                "Sockets",
                 "DeveloperSettings"
             }
             );
+
+        // epoll or poll backed socket poller, needs native handles of BSD sockets
+        // public, since poller layout depends on it
+        bool bWithEpoll = Target.Platform == UnrealTargetPlatform.Linux || Target.Platform == UnrealTargetPlatform.LinuxArm64;
+        bool bWithPoll = Target.Platform == UnrealTargetPlatform.Win64 || Target.Platform == UnrealTargetPlatform.Mac;
+        if (bWithEpoll || bWithPoll)
+            PrivateIncludePaths.Add(Path.Combine(GetModuleDirectory("Sockets"), "Private"));
+        PublicDefinitions.Add("RCON_WITH_EPOLL=" + (bWithEpoll ? "1" : "0"));
+        PublicDefinitions.Add("RCON_WITH_POLL=" + (bWithPoll ? "1" : "0"));
     }
 }
@@ -0,0 +1,482 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "RConBenchmarkCommandlet.h"
+
+#include <HAL/MemoryBase.h>
+#include <SocketSubsystem.h>
+#include <Sockets.h>
+
+#include <atomic>
+
+#include "RConServer.h"
+#include "RConServerSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(RConBenchmark, Log, All);
+
+namespace
+{
+    // Forwards everything to wrapped allocator, counting allocations made through GMalloc while any counter scope is active.
+    // Counts are process wide, so engine threads running in background add a bit of noise.
+    class FCountingMalloc final : public FMalloc
+    {
+    public:
+        explicit FCountingMalloc(FMalloc* InInner)
+            : Inner{InInner}
+        {
+        }
+
+        // installed on first use and never removed, other threads may hold on to GMalloc they read before
+        static FCountingMalloc& Get()
+        {
+            // FMalloc allocates itself with system malloc, not through GMalloc
+            static FCountingMalloc* Instance = []
+            {
+                FCountingMalloc* NewInstance = new FCountingMalloc(GMalloc);
+                GMalloc = NewInstance;
+                return NewInstance;
+            }();
+            return *Instance;
+        }
+
+        void* Malloc(SIZE_T Count, uint32 Alignment) override
+        {
+            CountAllocation();
+            return Inner->Malloc(Count, Alignment);
+        }
+
+        void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+        {
+            CountAllocation();
+            return Inner->TryMalloc(Count, Alignment);
+        }
+
+        void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+        {
+            CountAllocation();
+            return Inner->Realloc(Original, Count, Alignment);
+        }
+
+        void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+        {
+            CountAllocation();
+            return Inner->TryRealloc(Original, Count, Alignment);
+        }
+
+        void Free(void* Original) override { Inner->Free(Original); }
+        SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+        bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+        void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+        void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+        void MarkTLSCachesAsUsedOnCurrentThread() override { Inner->MarkTLSCachesAsUsedOnCurrentThread(); }
+        void MarkTLSCachesAsUnusedOnCurrentThread() override { Inner->MarkTLSCachesAsUnusedOnCurrentThread(); }
+        void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+        void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+        void UpdateStats() override { Inner->UpdateStats(); }
+        void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+        void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+        bool ValidateHeap() override { return Inner->ValidateHeap(); }
+        void OnPreFork() override { Inner->OnPreFork(); }
+        void OnPostFork() override { Inner->OnPostFork(); }
+        bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+        const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+        void BeginCounting() { ActiveScopes.fetch_add(1, std::memory_order_relaxed); }
+        void EndCounting() { ActiveScopes.fetch_sub(1, std::memory_order_relaxed); }
+        uint64 GetAllocations() const { return Allocations.load(std::memory_order_relaxed); }
+
+    private:
+        void CountAllocation()
+        {
+            if (ActiveScopes.load(std::memory_order_relaxed) > 0)
+                Allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        FMalloc* Inner;
+        std::atomic<int32> ActiveScopes{};
+        std::atomic<uint64> Allocations{};
+    };
+
+    // Counts allocations made while in scope, through process wide FCountingMalloc
+    class FScopedAllocationCounter
+    {
+    public:
+        FScopedAllocationCounter()
+            : Counter{FCountingMalloc::Get()}
+            , StartAllocations{Counter.GetAllocations()}
+        {
+            Counter.BeginCounting();
+        }
+
+        ~FScopedAllocationCounter()
+        {
+            Counter.EndCounting();
+        }
+
+        uint64 Get() const { return Counter.GetAllocations() - StartAllocations; }
+
+    private:
+        FCountingMalloc& Counter;
+        uint64 StartAllocations;
+    };
+
+    struct FBenchmarkClient
+    {
+        FSocket* Socket{};
+        TArray<uint8> SendBuffer{};
+        int32 SendOffset{};
+        TArray<uint8> RecvBuffer{};
+        // decoded packets, reused between pumps
+        TArray<FRConPacket> Packets{};
+        bool bAuthorized{};
+        int32 Sent{};
+        int32 Received{};
+        // send time of each command, indexed by packet id - 1
+        TArray<double> SendTimes{};
+    };
+
+    struct FLoadTestTotals
+    {
+        uint64 BytesSent{};
+        uint64 BytesReceived{};
+        TArray<double> Latencies{};
+    };
+
+    // @return false if connection got closed
+    bool PumpClient(FBenchmarkClient& Client, FLoadTestTotals& Totals)
+    {
+        if (Client.SendOffset < Client.SendBuffer.Num())
+        {
+            int32 BytesSent{};
+            if (Client.Socket->Send(Client.SendBuffer.GetData() + Client.SendOffset, Client.SendBuffer.Num() - Client.SendOffset, BytesSent))
+            {
+                Client.SendOffset += BytesSent;
+                Totals.BytesSent += BytesSent;
+                if (Client.SendOffset == Client.SendBuffer.Num())
+                {
+                    Client.SendBuffer.Reset();
+                    Client.SendOffset = 0;
+                }
+            }
+        }
+
+        uint8 Chunk[16 * 1024];
+        int32 BytesRead{};
+        if (!Client.Socket->Recv(Chunk, sizeof(Chunk), BytesRead))
+            return false;
+        if (BytesRead == 0)
+            return true;
+
+        Totals.BytesReceived += BytesRead;
+        Client.RecvBuffer.Append(Chunk, BytesRead);
+
+        const double Now = FPlatformTime::Seconds();
+
+        int32 NumPackets{};
+        const int32 Offset = FRConPacket::DeserializePackets(Client.RecvBuffer.GetData(), Client.RecvBuffer.Num(), Client.Packets, NumPackets, CRConMinPacketSize + CRConMaxResponseBodySize);
+        if (Offset == INDEX_NONE)
+            return false;
+
+        for (int32 i = 0; i < NumPackets; ++i)
+        {
+            const FRConPacket& Packet = Client.Packets[i];
+            if (Packet.Type == ERConPacketType::AuthResponse && !Client.bAuthorized)
+            {
+                Client.bAuthorized = Packet.Id != -1;
+            }
+            else if (Packet.Type == ERConPacketType::ResponseValue && Client.SendTimes.IsValidIndex(Packet.Id - 1))
+            {
+                Totals.Latencies.Add(Now - Client.SendTimes[Packet.Id - 1]);
+                ++Client.Received;
+            }
+        }
+        Client.RecvBuffer.RemoveAt(0, Offset, EAllowShrinking::No);
+
+        return true;
+    }
+} // namespace
+
+URConBenchmarkCommandlet::URConBenchmarkCommandlet()
+{
+    IsClient = false;
+    IsServer = true;
+    IsEditor = false;
+    LogToConsole = true;
+
+    HelpDescription = TEXT("Measures RCon server throughput, latency and allocations on loopback");
+    HelpUsage = TEXT("-run=RConBenchmark [-Clients=32] [-Commands=1000] [-Pipeline=4] [-BodySize=64] [-ResponseSize=256] [-Port=27999] [-Iterations=100000] [-NetworkThread] [-SkipLoad] [-SkipMicro]");
+}
+
+int32 URConBenchmarkCommandlet::Main(const FString& Params)
+{
+    bool bSuccess = true;
+
+    // before benchmark starts threads of its own
+    FCountingMalloc::Get();
+
+    if (!FParse::Param(*Params, TEXT("SkipLoad")))
+        bSuccess = RunLoadTest(Params);
+
+    if (!FParse::Param(*Params, TEXT("SkipMicro")))
+        RunMicrobenchmarks(Params);
+
+    return bSuccess ? 0 : 1;
+}
+
+bool URConBenchmarkCommandlet::RunLoadTest(const FString& Params)
+{
+    int32 NumClients{32};
+    int32 CommandsPerClient{1000};
+    int32 Pipeline{4};
+    int32 BodySize{64};
+    int32 ResponseSize{256};
+    int32 Port{27999};
+    FParse::Value(*Params, TEXT("Clients="), NumClients);
+    FParse::Value(*Params, TEXT("Commands="), CommandsPerClient);
+    FParse::Value(*Params, TEXT("Pipeline="), Pipeline);
+    FParse::Value(*Params, TEXT("BodySize="), BodySize);
+    FParse::Value(*Params, TEXT("ResponseSize="), ResponseSize);
+    FParse::Value(*Params, TEXT("Port="), Port);
+
+    NumClients = FMath::Clamp(NumClients, 1, static_cast<int32>(MAX_uint16));
+    CommandsPerClient = FMath::Max(CommandsPerClient, 1);
+    Pipeline = FMath::Max(Pipeline, 1);
+    // keep every command and response within a single packet, so one response means one completed command
+    BodySize = FMath::Clamp(BodySize, 1, CRConMaxPacketSize - CRConMinPacketSize);
+    ResponseSize = FMath::Clamp(ResponseSize, 0, CRConMaxResponseBodySize);
+
+    FRConServer::FSettings Settings{};
+    Settings.Port = static_cast<uint16>(Port);
+    Settings.Password = TEXT("benchmark");
+    Settings.MaxActiveConnections = static_cast<uint16>(NumClients);
+    Settings.bUseNetworkThread = FParse::Param(*Params, TEXT("NetworkThread"));
+    // measure raw server cost, budget and rate limit would only throttle simulated clients
+    Settings.MaxCommandsPerTick = 0;
+    Settings.CommandTimeBudgetMs = 0.0;
+    Settings.CommandRateLimit = 0.0;
+    // all clients connect before any of them authenticates, all of them from loopback
+    Settings.MaxUnauthenticatedConnections = 0;
+    Settings.AuthTimeout = 0.0;
+    Settings.MaxAuthFailures = 0;
+
+    FRConServer Server{};
+    if (!Server.Start(Settings))
+    {
+        UE_LOG(RConBenchmark, Error, TEXT("Failed to start server on port %d"), Port);
+        return false;
+    }
+
+    const FString ResponseBody = FString::ChrN(ResponseSize, TEXT('x'));
+    Server.AssignCommandCallback(FRConServer::FHandleReceivedCommandDelegate::CreateLambda(
+        [&ResponseBody](int32 RequestId, const FString& Command, FString& Response, bool& bDelayResponse)
+        {
+            Response = ResponseBody;
+        }));
+
+    ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+    TSharedRef<FInternetAddr> ServerAddress = SocketSubsystem->CreateInternetAddr(FNetworkProtocolTypes::IPv4);
+    ServerAddress->SetLoopbackAddress();
+    ServerAddress->SetPort(Server.GetBoundPort());
+
+    TArray<FBenchmarkClient> Clients{};
+    Clients.SetNum(NumClients);
+    for (FBenchmarkClient& Client : Clients)
+    {
+        Client.Socket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("RConBenchmarkClient"), FNetworkProtocolTypes::IPv4);
+        if (!Client.Socket || !Client.Socket->Connect(*ServerAddress))
+        {
+            UE_LOG(RConBenchmark, Error, TEXT("Failed to connect benchmark client"));
+            break;
+        }
+        Client.Socket->SetNonBlocking();
+        Client.Socket->SetNoDelay();
+        Client.SendTimes.SetNumZeroed(CommandsPerClient);
+        FRConPacket::SerializePacket(Client.SendBuffer, 0, ERConPacketType::Auth, Settings.Password);
+
+        // keep listen backlog drained while connecting
+        Server.Tick();
+    }
+
+    FLoadTestTotals Totals{};
+    Totals.Latencies.Reserve(NumClients * CommandsPerClient);
+
+    const auto PumpAll = [&]()
+    {
+        Server.Tick();
+        for (FBenchmarkClient& Client : Clients)
+        {
+            if (Client.Socket && !PumpClient(Client, Totals))
+            {
+                UE_LOG(RConBenchmark, Warning, TEXT("Benchmark client disconnected by server"));
+                SocketSubsystem->DestroySocket(Client.Socket);
+                Client.Socket = nullptr;
+            }
+        }
+    };
+
+    constexpr double StallTimeout = 10.0;
+
+    // authenticate everyone before measuring
+    double LastProgressTime = FPlatformTime::Seconds();
+    int32 NumAuthorized{};
+    while (NumAuthorized < NumClients && FPlatformTime::Seconds() - LastProgressTime < StallTimeout)
+    {
+        PumpAll();
+
+        int32 NewNumAuthorized{};
+        for (const FBenchmarkClient& Client : Clients)
+            NewNumAuthorized += Client.bAuthorized ? 1 : 0;
+        if (NewNumAuthorized != NumAuthorized)
+            LastProgressTime = FPlatformTime::Seconds();
+        NumAuthorized = NewNumAuthorized;
+    }
+
+    if (NumAuthorized < NumClients)
+        UE_LOG(RConBenchmark, Warning, TEXT("Only %d out of %d clients authenticated"), NumAuthorized, NumClients);
+
+    const FString CommandBody = FString(TEXT("bench ")) + FString::ChrN(FMath::Max(BodySize - 6, 0), TEXT('x'));
+    const int32 ExpectedCommands = NumAuthorized * CommandsPerClient;
+
+    int32 CompletedCommands{};
+    double StartTime{};
+    double EndTime{};
+    uint64 Allocations{};
+    {
+        FScopedAllocationCounter AllocationCounter{};
+
+        StartTime = FPlatformTime::Seconds();
+        LastProgressTime = StartTime;
+
+        while (CompletedCommands < ExpectedCommands && FPlatformTime::Seconds() - LastProgressTime < StallTimeout)
+        {
+            const double Now = FPlatformTime::Seconds();
+            for (FBenchmarkClient& Client : Clients)
+            {
+                if (!Client.Socket || !Client.bAuthorized)
+                    continue;
+
+                // keep up to Pipeline commands in flight
+                while (Client.Sent < CommandsPerClient && Client.Sent - Client.Received < Pipeline)
+                {
+                    Client.SendTimes[Client.Sent] = Now;
+                    ++Client.Sent;
+                    FRConPacket::SerializePacket(Client.SendBuffer, Client.Sent, ERConPacketType::ExecCommand, CommandBody);
+                }
+            }
+
+            PumpAll();
+
+            const int32 NewCompletedCommands = Totals.Latencies.Num();
+            if (NewCompletedCommands != CompletedCommands)
+                LastProgressTime = FPlatformTime::Seconds();
+            CompletedCommands = NewCompletedCommands;
+        }
+
+        EndTime = FPlatformTime::Seconds();
+        Allocations = AllocationCounter.Get();
+    }
+
+    for (FBenchmarkClient& Client : Clients)
+    {
+        if (Client.Socket)
+        {
+            Client.Socket->Close();
+            SocketSubsystem->DestroySocket(Client.Socket);
+        }
+    }
+    Server.Stop();
+
+    if (CompletedCommands < ExpectedCommands)
+        UE_LOG(RConBenchmark, Warning, TEXT("Load test stalled, %d out of %d commands completed"), CompletedCommands, ExpectedCommands);
+
+    if (CompletedCommands == 0)
+    {
+        UE_LOG(RConBenchmark, Error, TEXT("No commands completed"));
+        return false;
+    }
+
+    Totals.Latencies.Sort();
+    const auto Percentile = [&Totals](double Fraction)
+    {
+        const int32 Index = FMath::Min(static_cast<int32>(Totals.Latencies.Num() * Fraction), Totals.Latencies.Num() - 1);
+        return Totals.Latencies[Index] * 1000.0;
+    };
+
+    const double Elapsed = FMath::Max(EndTime - StartTime, UE_SMALL_NUMBER);
+    UE_LOG(RConBenchmark, Display, TEXT("Load test: %d clients, pipeline %d, body %d bytes, response %d bytes, network thread %d"), NumClients, Pipeline, BodySize, ResponseSize, Settings.bUseNetworkThread);
+    UE_LOG(RConBenchmark, Display, TEXT("  commands:      %d in %.3f s"), CompletedCommands, Elapsed);
+    UE_LOG(RConBenchmark, Display, TEXT("  throughput:    %.0f commands/s"), CompletedCommands / Elapsed);
+    UE_LOG(RConBenchmark, Display, TEXT("  latency:       p50 %.3f ms, p99 %.3f ms, max %.3f ms"), Percentile(0.5), Percentile(0.99), Totals.Latencies.Last() * 1000.0);
+    UE_LOG(RConBenchmark, Display, TEXT("  bytes/command: %.1f sent, %.1f received"), static_cast<double>(Totals.BytesSent) / CompletedCommands, static_cast<double>(Totals.BytesReceived) / CompletedCommands);
+    UE_LOG(RConBenchmark, Display, TEXT("  allocs/command: %.2f (process wide, includes benchmark clients)"), static_cast<double>(Allocations) / CompletedCommands);
+
+    return CompletedCommands == ExpectedCommands;
+}
+
+void URConBenchmarkCommandlet::RunMicrobenchmarks(const FString& Params)
+{
+    int32 Iterations{100000};
+    FParse::Value(*Params, TEXT("Iterations="), Iterations);
+    Iterations = FMath::Max(Iterations, 1);
+
+    const auto Report = [Iterations](const TCHAR* Name, double Elapsed, uint64 Allocations)
+    {
+        UE_LOG(RConBenchmark, Display, TEXT("  %-24s %8.1f ns/op, %.2f allocs/op"), Name, Elapsed * 1.0e9 / Iterations, static_cast<double>(Allocations) / Iterations);
+    };
+
+    UE_LOG(RConBenchmark, Display, TEXT("Microbenchmarks: %d iterations"), Iterations);
+
+    const FString Body = TEXT("exec stat fps with some arguments");
+
+    {
+        TArray<uint8> Buffer{};
+        Buffer.Reserve(FRConPacket::GetSerializedSize(CRConMaxPacketSize));
+
+        FScopedAllocationCounter AllocationCounter{};
+        const double StartTime = FPlatformTime::Seconds();
+        for (int32 i = 0; i < Iterations; ++i)
+        {
+            Buffer.Reset();
+            FRConPacket::SerializePacket(Buffer, i, ERConPacketType::ExecCommand, Body);
+        }
+        Report(TEXT("SerializePacket"), FPlatformTime::Seconds() - StartTime, AllocationCounter.Get());
+    }
+
+    {
+        const TArray<uint8> Serialized = FRConPacket::SerializePacket(FRConPacket{1, ERConPacketType::ExecCommand, Body});
+
+        // warm up, so body allocation is reused by measured iterations
+        FRConPacket Packet{};
+        FRConPacket::DeserializePacket(Serialized.GetData(), Serialized.Num(), Packet);
+
+        int32 Checksum{};
+        FScopedAllocationCounter AllocationCounter{};
+        const double StartTime = FPlatformTime::Seconds();
+        for (int32 i = 0; i < Iterations; ++i)
+        {
+            FRConPacket::DeserializePacket(Serialized.GetData(), Serialized.Num(), Packet);
+            Checksum += Packet.Id;
+        }
+        Report(TEXT("DeserializePacket"), FPlatformTime::Seconds() - StartTime, AllocationCounter.Get());
+        UE_LOG(RConBenchmark, Verbose, TEXT("Deserialize checksum %d"), Checksum);
+    }
+
+    {
+        // typical amount of game specific commands registered next to default ones
+        URConServerSubsystem* Subsystem = NewObject<URConServerSubsystem>(GetTransientPackage());
+        for (int32 i = 0; i < 100; ++i)
+            Subsystem->AddCommand(FString::Printf(TEXT("bench command%d"), i), FRConServerCommandCallback());
+
+        const FString Command = TEXT("bench command50 first second third");
+
+        int32 NumFound{};
+        FScopedAllocationCounter AllocationCounter{};
+        const double StartTime = FPlatformTime::Seconds();
+        for (int32 i = 0; i < Iterations; ++i)
+        {
+            if (Subsystem->FindCommandHandle(Command))
+                ++NumFound;
+        }
+        Report(TEXT("FindCommandHandle"), FPlatformTime::Seconds() - StartTime, AllocationCounter.Get());
+        UE_CLOG(NumFound != Iterations, RConBenchmark, Warning, TEXT("FindCommandHandle missed command"));
+    }
+}
@@ -0,0 +1,25 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <Commandlets/Commandlet.h>
+#include <CoreMinimal.h>
+
+#include "RConBenchmarkCommandlet.generated.h"
+
+// Load test of FRConServer on loopback with simulated Source RCON clients, plus microbenchmarks of hot paths.
+// Usage: -run=RConBenchmark [-Clients=32] [-Commands=1000] [-Pipeline=4] [-BodySize=64] [-ResponseSize=256] [-Port=27999] [-Iterations=100000] [-NetworkThread] [-SkipLoad] [-SkipMicro]
+UCLASS()
+class URConBenchmarkCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+public:
+    URConBenchmarkCommandlet();
+
+    int32 Main(const FString& Params) override;
+
+private:
+    bool RunLoadTest(const FString& Params);
+
+    void RunMicrobenchmarks(const FString& Params);
+};
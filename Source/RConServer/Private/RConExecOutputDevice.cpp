@@ -0,0 +1,81 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "RConExecOutputDevice.h"
+
+#include "RConResponseWriter.h"
+#include "RConServer.h"
+
+FRConExecOutputDevice::FRConExecOutputDevice(FRConServer* InServer, int32 InRequestId, int32 InMaxOutputSize, bool bInEscapeJson)
+    : Server{InServer}
+    , RequestId{InRequestId}
+    , RemainingOutput{InMaxOutputSize > 0 ? InMaxOutputSize : MAX_int32}
+    , bEscapeJson{bInEscapeJson}
+{
+    Chunk.Reserve(ChunkSize);
+}
+
+void FRConExecOutputDevice::Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category)
+{
+    if (bTruncated)
+        return;
+
+    // separator between lines, except the very first one
+    FStringView Line{V};
+    const int32 SeparatorLen = bHasOutput ? 1 : 0;
+    bHasOutput = true;
+
+    if (Line.Len() + SeparatorLen > RemainingOutput)
+    {
+        Line.LeftInline(FMath::Max(RemainingOutput - SeparatorLen, 0));
+        bTruncated = true;
+    }
+    RemainingOutput -= Line.Len() + SeparatorLen;
+
+    if (SeparatorLen)
+        AppendOutput(TEXT("\n"));
+
+    if (!Server)
+    {
+        AppendOutput(Line);
+    }
+    else
+    {
+        while (!Line.IsEmpty())
+        {
+            // flush only before appending more, so last chunk always left for final response
+            if (Chunk.Len() >= ChunkSize)
+                FlushChunk();
+
+            const int32 Count = FMath::Min(Line.Len(), ChunkSize - Chunk.Len());
+            AppendOutput(Line.Left(Count));
+            Line.RightChopInline(Count);
+        }
+    }
+
+    if (bTruncated)
+        AppendOutput(TEXT("\n... output truncated"));
+}
+
+void FRConExecOutputDevice::Write(FStringView Text)
+{
+    Chunk.Append(Text);
+}
+
+FString FRConExecOutputDevice::Finish()
+{
+    return MoveTemp(Chunk);
+}
+
+void FRConExecOutputDevice::AppendOutput(FStringView Text)
+{
+    if (bEscapeJson)
+        FRConResponseWriter::AppendJsonEscaped(Chunk, Text);
+    else
+        Chunk.Append(Text);
+}
+
+void FRConExecOutputDevice::FlushChunk()
+{
+    Server->SendPartialResponse(RequestId, MoveTemp(Chunk));
+    Chunk.Reset(ChunkSize);
+}
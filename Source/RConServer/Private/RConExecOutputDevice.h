@@ -0,0 +1,44 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Misc/OutputDevice.h>
+
+#include "RConCommon.h"
+
+class FRConServer;
+
+// Collects exec output into fixed size chunks, full chunks sent to client right away as partial responses
+// Without server whole output is collected, for requests whose response is not theirs alone, like commands of a batch
+class FRConExecOutputDevice final : public FOutputDevice
+{
+public:
+    // characters buffered before chunk sent, matches a few max sized packets
+    static constexpr int32 ChunkSize = 4 * CRConMaxResponseBodySize;
+
+    // @param InServer streams full chunks as partial responses of InRequestId, nullptr to collect everything
+    // @param bInEscapeJson output written as content of JSON string, limits still count unescaped characters
+    FRConExecOutputDevice(FRConServer* InServer, int32 InRequestId, int32 InMaxOutputSize, bool bInEscapeJson);
+
+    using FOutputDevice::Serialize;
+    void Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category) override;
+
+    void Write(FStringView Text);
+
+    // @return rest of output, that should be sent as final response
+    FString Finish();
+
+private:
+    void AppendOutput(FStringView Text);
+
+    void FlushChunk();
+
+    FRConServer* Server;
+    int32 RequestId;
+    int32 RemainingOutput;
+    bool bEscapeJson;
+    bool bHasOutput{};
+    bool bTruncated{};
+    FString Chunk{};
+};
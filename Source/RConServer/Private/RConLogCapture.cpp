@@ -0,0 +1,38 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include "RConLogCapture.h"
+
+FRConLogCapture::FRConLogCapture(int32 InCapacity)
+    : Capacity{FMath::Max(InCapacity, 1)}
+{
+}
+
+void FRConLogCapture::Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category)
+{
+    const ELogVerbosity::Type LineVerbosity = static_cast<ELogVerbosity::Type>(Verbosity & ELogVerbosity::VerbosityMask);
+    if (LineVerbosity > MaxVerbosity.load(std::memory_order_relaxed))
+        return;
+
+    // own categories log every sent packet, capturing them would feed subscriptions with their own output
+    static const FName RConServerCategory{TEXT("RConServer")};
+    static const FName RConServerSubsystemCategory{TEXT("RConServerSubsystem")};
+    if (Category == RConServerCategory || Category == RConServerSubsystemCategory)
+        return;
+
+    if (NumLines.fetch_add(1, std::memory_order_relaxed) >= Capacity)
+    {
+        NumLines.fetch_sub(1, std::memory_order_relaxed);
+        DroppedLines.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Lines.Enqueue(FLine{Category, LineVerbosity, FString(V)});
+}
+
+bool FRConLogCapture::Dequeue(FLine& OutLine)
+{
+    if (!Lines.Dequeue(OutLine))
+        return false;
+
+    NumLines.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
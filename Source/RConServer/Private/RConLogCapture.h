@@ -0,0 +1,45 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#pragma once
+
+#include <Containers/Queue.h>
+#include <CoreMinimal.h>
+#include <Misc/OutputDevice.h>
+
+#include <atomic>
+
+// Collects log lines from any thread into bounded queue, drained on game thread by log subscriptions
+// Lines beyond capacity are dropped and counted, so slow draining never grows memory without limit
+class FRConLogCapture final : public FOutputDevice
+{
+public:
+    struct FLine
+    {
+        FName Category;
+        ELogVerbosity::Type Verbosity;
+        FString Text;
+    };
+
+    explicit FRConLogCapture(int32 InCapacity);
+
+    using FOutputDevice::Serialize;
+    void Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category) override;
+    bool CanBeUsedOnAnyThread() const override { return true; }
+    bool CanBeUsedOnMultipleThreads() const override { return true; }
+
+    // lines more verbose than that are ignored right away
+    void SetMaxVerbosity(ELogVerbosity::Type InVerbosity) { MaxVerbosity.store(InVerbosity, std::memory_order_relaxed); }
+
+    // game thread only
+    bool Dequeue(FLine& OutLine);
+
+    // @return lines dropped since previous call
+    int32 ConsumeDroppedLines() { return DroppedLines.exchange(0, std::memory_order_relaxed); }
+
+private:
+    TQueue<FLine, EQueueMode::Mpsc> Lines{};
+    std::atomic<int32> NumLines{};
+    std::atomic<int32> DroppedLines{};
+    std::atomic<int32> MaxVerbosity{ELogVerbosity::NoLogging};
+    int32 Capacity;
+};
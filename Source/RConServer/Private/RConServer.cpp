@@ -2,10 +2,69 @@
 
 #include "RConServer.h"
 
+#include <HAL/PlatformFileManager.h>
+#include <HAL/PlatformProcess.h>
+#include <HAL/RunnableThread.h>
+#include <Misc/Paths.h>
+
+#include <atomic>
+
+#include "RConSocketPoller.h"
+#include "RConStats.h"
+
 IMPLEMENT_MODULE(FRConServerModule, RConServer)
 
 DEFINE_LOG_CATEGORY_STATIC(RConServer, Log, Log);
 
+DECLARE_CYCLE_STAT(TEXT("Server Tick"), STAT_RConServerTick, STATGROUP_RCon);
+DECLARE_CYCLE_STAT(TEXT("Server Network Tick"), STAT_RConServerTickNetwork, STATGROUP_RCon);
+DECLARE_CYCLE_STAT(TEXT("Server Process Incoming"), STAT_RConServerProcessIncoming, STATGROUP_RCon);
+DECLARE_CYCLE_STAT(TEXT("Server Process Outgoing"), STAT_RConServerProcessOutgoing, STATGROUP_RCon);
+DECLARE_CYCLE_STAT(TEXT("Server Dispatch Commands"), STAT_RConServerDispatchCommands, STATGROUP_RCon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active Connections"), STAT_RConActiveConnections, STATGROUP_RCon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Queued Commands"), STAT_RConQueuedCommands, STATGROUP_RCon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pending Requests"), STAT_RConPendingRequests, STATGROUP_RCon);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Send Backlog"), STAT_RConSendBacklog, STATGROUP_RCon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bytes Received"), STAT_RConBytesReceived, STATGROUP_RCon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bytes Sent"), STAT_RConBytesSent, STATGROUP_RCon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Packets Received"), STAT_RConPacketsReceived, STATGROUP_RCon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Packets Sent"), STAT_RConPacketsSent, STATGROUP_RCon);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Commands Dispatched"), STAT_RConCommandsDispatched, STATGROUP_RCon);
+
+class FRConServer::FNetworkRunnable final : public FRunnable
+{
+public:
+    explicit FNetworkRunnable(FRConServer& InServer)
+        : Server{InServer}
+    {
+    }
+
+    uint32 Run() override
+    {
+        while (!bStopping)
+        {
+            Server.TickNetwork(Server.Settings.NetworkThreadWaitTime);
+        }
+        return 0;
+    }
+
+    void Stop() override
+    {
+        bStopping = true;
+        Server.Poller->Wake();
+    }
+
+private:
+    FRConServer& Server;
+    std::atomic<bool> bStopping{false};
+};
+
+FRConServer::~FRConServer()
+{
+    if (bStarted)
+        Stop();
+}
+
 bool FRConServer::Start(const FSettings& InSettings)
 {
     // prevent ability to start in game shipping build unless allowed
@@ -20,40 +79,98 @@ bool FRConServer::Start(const FSettings& InSettings)
 
     auto SocketSubsystem = GetSocketSubsystem();
 
-    FUniqueSocket NewSocket = SocketSubsystem->CreateUniqueSocket(NAME_Stream, TEXT("RConServer"));
-
     TSharedRef<FInternetAddr> SocketAddress = SocketSubsystem->CreateInternetAddr(FNetworkProtocolTypes::IPv4);
     SocketAddress->SetAnyAddress();
     SocketAddress->SetPort(InSettings.Port);
 
-    const bool bBlocking = NewSocket->SetNonBlocking();
-    if (!bBlocking)
-        UE_LOG(RConServer, Warning, TEXT("Failed SetNonBlocking for listen socket"))
-
-    const bool bReuse = NewSocket->SetReuseAddr(InSettings.bAllowPortReuse);
-    if (!bReuse)
-        UE_LOG(RConServer, Warning, TEXT("Failed SetReuseAddr for listen socket"))
+    FUniqueSocket NewSocket = CreateListenSocket(*SocketAddress, InSettings, 10);
+    if (!NewSocket)
+        return false;
+    BoundPort = SocketAddress->GetPort();
 
-    BoundPort = SocketSubsystem->BindNextPort(NewSocket.Get(), *SocketAddress, 10, 1);
-    if (BoundPort == 0)
+    // exact port, other processes on the host expect to find it there
+    FUniqueSocket NewLoopbackSocket{};
+    if (InSettings.LoopbackPort)
     {
-        UE_LOG(RConServer, Error, TEXT("Failed bind to address: %s"), *SocketAddress->ToString(true))
-        return false;
+        TSharedRef<FInternetAddr> LoopbackAddress = SocketSubsystem->CreateInternetAddr(FNetworkProtocolTypes::IPv4);
+        LoopbackAddress->SetLoopbackAddress();
+        LoopbackAddress->SetPort(InSettings.LoopbackPort);
+
+        NewLoopbackSocket = CreateListenSocket(*LoopbackAddress, InSettings, 1);
+        if (!NewLoopbackSocket)
+            return false;
     }
 
-    const bool bListen = NewSocket->Listen(3);
-    if (!bListen)
+    TUniquePtr<FRConSocketPoller> NewPoller = MakeUnique<FRConSocketPoller>();
+    if (!NewPoller->IsValid() || !NewPoller->Add(NewSocket.Get(), ListenSocketKey) || (NewLoopbackSocket && !NewPoller->Add(NewLoopbackSocket.Get(), LoopbackListenSocketKey)))
     {
-        UE_LOG(RConServer, Error, TEXT("Failed start listen with bind address: %s"), *SocketAddress->ToString(true))
+        UE_LOG(RConServer, Error, TEXT("Failed to initialize socket poller"))
         return false;
     }
 
     Settings = InSettings;
+
+    CredentialDigests.Reset(1 + Settings.Credentials.Num());
+    for (int32 Principal = 0; Principal < 1 + Settings.Credentials.Num(); ++Principal)
+    {
+        FString& Password = Principal == 0 ? Settings.Password : Settings.Credentials[Principal - 1].Password;
+        UE_CLOG(FindPrincipal(Password) != INDEX_NONE, RConServer, Warning, TEXT("Credential '%s' has the same password as one before it and will never be matched"), *Settings.Credentials[Principal - 1].Name);
+
+        FCredentialDigest& CredentialDigest = CredentialDigests.AddDefaulted_GetRef();
+        const FGuid Salt = FGuid::NewGuid();
+        FMemory::Memcpy(CredentialDigest.Salt, &Salt, sizeof(CredentialDigest.Salt));
+        ComputeCredentialDigest(CredentialDigest.Salt, Password, CredentialDigest.Digest);
+
+        // plaintext is not needed anymore
+        Password.Empty();
+    }
+
+    ConnectionSlots.SetNum(Settings.MaxActiveConnections);
+    FreeSlots.Reset(Settings.MaxActiveConnections);
+    LiveSlots.Reset(Settings.MaxActiveConnections);
+    // popped from the end, so lower slots handed out first
+    for (int32 i = Settings.MaxActiveConnections - 1; i > -1; --i)
+        FreeSlots.Add(static_cast<uint16>(i));
+
+    SendBacklogs = MakeUnique<std::atomic<int32>[]>(Settings.MaxActiveConnections);
+
+    PeerAddress = GetSocketSubsystem()->CreateInternetAddr();
+    AddressRecords.Reset();
+    if (Settings.MaxAuthFailures > 0)
+        AddressRecords.SetNum(AddressTableSize);
+    UnauthenticatedConnections = 0;
+
+    CommandQueues.SetNum(Settings.MaxActiveConnections);
+    ReadyCommandQueues.Reset(Settings.MaxActiveConnections);
+    NextReadyCommandQueue = 0;
+
     ListenSocket = MoveTemp(NewSocket);
+    LoopbackListenSocket = MoveTemp(NewLoopbackSocket);
+    Poller = MoveTemp(NewPoller);
     bStarted = true;
 
     ListenSocket->GetAddress(*SocketAddress);
     UE_LOG(RConServer, Log, TEXT("RCon started using %s port (requested port: %d)"), *SocketAddress->ToString(true), Settings.Port);
+    if (LoopbackListenSocket)
+        UE_LOG(RConServer, Log, TEXT("RCon also listens on loopback port %d"), Settings.LoopbackPort);
+
+    if (Settings.bUseNetworkThread)
+    {
+        if (!FRConSocketPoller::HasReadinessBackend())
+        {
+            // thread would sleep through incoming commands, game thread ticks sooner
+            UE_LOG(RConServer, Warning, TEXT("No socket readiness backend on this platform, network work stays on game thread"));
+        }
+        else if (FPlatformProcess::SupportsMultithreading())
+        {
+            NetworkRunnable = MakeUnique<FNetworkRunnable>(*this);
+            NetworkThread.Reset(FRunnableThread::Create(NetworkRunnable.Get(), TEXT("RConServerNetwork")));
+        }
+        else
+        {
+            UE_LOG(RConServer, Warning, TEXT("Multithreading not supported, network work stays on game thread"));
+        }
+    }
 
     return true;
 }
@@ -63,39 +180,59 @@ void FRConServer::Tick()
     if (!ListenSocket)
         return;
 
-    if (!ActiveConnections && ClientConnections.Num())
-        TryPurgeOldConnections();
+    SCOPE_CYCLE_COUNTER(STAT_RConServerTick);
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConServer::Tick);
 
-    ProcessNewConnections();
+    if (!NetworkThread)
+        TickNetwork(0);
 
-    for (auto& Connection : ClientConnections)
-    {
-        if (!Connection->Socket)
-            continue;
+    DispatchIncomingEvents();
+    ExpirePendingRequests();
 
-        if (!CheckConnection(*Connection))
-        {
-            UE_LOG(RConServer, Log, TEXT("Client %d disconnected"), Connection->Id);
-            CloseConnection(*Connection);
-            continue;
-        }
+    if (!NetworkThread)
+        FlushOutgoing();
 
-        ProcessIncoming(*Connection);
-        ProcessOutcoming(*Connection);
-    }
+    PublishStats();
 }
 
 void FRConServer::Stop()
 {
     UE_LOG(RConServer, Verbose, TEXT("RCon stop invoked. Is started: %d"), bStarted);
 
+    if (NetworkThread)
+    {
+        NetworkThread->Kill(true);
+        NetworkThread.Reset();
+        NetworkRunnable.Reset();
+    }
+
+    if (ListenSocket)
+        Poller->Remove(ListenSocket.Get(), ListenSocketKey);
     ListenSocket.Reset();
 
-    for (auto& Connection : ClientConnections)
+    if (LoopbackListenSocket)
+        Poller->Remove(LoopbackListenSocket.Get(), LoopbackListenSocketKey);
+    LoopbackListenSocket.Reset();
+
+    while (LiveSlots.Num())
     {
-        CloseConnection(*Connection);
+        CloseConnection(ConnectionSlots[LiveSlots.Last()]);
     }
-    ClientConnections.Reset();
+    ConnectionSlots.Empty();
+    FreeSlots.Empty();
+    SendBacklogs.Reset();
+
+    Poller.Reset();
+
+    IncomingEvents.Empty();
+    OutgoingResponses.Empty();
+    CommandQueues.Empty();
+    ReadyCommandQueues.Empty();
+    PendingRequests.Reset();
+    PendingRequestDeadlines.Empty();
+    ResponseFormats.Reset();
+    ConnectionPrincipals.Reset();
+    CredentialDigests.Reset();
 
     bStarted = false;
 }
@@ -110,12 +247,115 @@ void FRConServer::AssignCommandCallback(FHandleReceivedCommandDelegate InCallbac
     ExecCommandCallback = InCallback;
 }
 
+void FRConServer::AssignRequestCanceledCallback(FHandleRequestCanceledDelegate InCallback)
+{
+    RequestCanceledCallback = InCallback;
+}
+
 void FRConServer::SendResponse(const int32 RequestId, const FString& Response)
 {
-    for (auto& Connection : ClientConnections)
-        for (const auto [LocalRequestId, RealRequestId] : Connection->RequestIdMapping)
-            if (LocalRequestId == RequestId)
-                EnqueueResponse(*Connection, RealRequestId, ERConPacketType::ResponseValue, Response);
+    FPendingRequest Request{};
+    if (PendingRequests.RemoveAndCopyValue(RequestId, Request))
+    {
+        EnqueueOutgoing(Request.ConnectionId, Request.PacketId, Response);
+    }
+    else
+    {
+        UE_LOG(RConServer, Verbose, TEXT("Dropping response for request %d, it timed out or client disconnected"), RequestId);
+    }
+}
+
+void FRConServer::SendPartialResponse(const int32 RequestId, FString Response)
+{
+    // empty packet would be taken for terminator by clients
+    if (Response.IsEmpty())
+        return;
+
+    const FPendingRequest* Request = FindRequest(RequestId);
+    if (Request)
+    {
+        EnqueueOutgoing(Request->ConnectionId, Request->PacketId, MoveTemp(Response));
+    }
+    else
+    {
+        UE_LOG(RConServer, Verbose, TEXT("Dropping partial response for request %d, it timed out or client disconnected"), RequestId);
+    }
+}
+
+void FRConServer::KeepRequestOpen(const int32 RequestId)
+{
+    if (RequestId == DispatchingRequestId)
+    {
+        DispatchingRequest.bKeepOpen = true;
+    }
+    else if (FPendingRequest* Request = PendingRequests.Find(RequestId))
+    {
+        Request->bKeepOpen = true;
+    }
+}
+
+int32 FRConServer::GetRequestSendBacklog(const int32 RequestId) const
+{
+    const FPendingRequest* Request = FindRequest(RequestId);
+    return Request && SendBacklogs ? SendBacklogs[Request->ConnectionId & 0xFFFF].load(std::memory_order_relaxed) : 0;
+}
+
+uint32 FRConServer::GetRequestConnectionId(const int32 RequestId) const
+{
+    const FPendingRequest* Request = FindRequest(RequestId);
+    return Request ? Request->ConnectionId : 0;
+}
+
+FRConServer::FStats FRConServer::GetStats() const
+{
+    FStats Stats{};
+    Stats.BytesReceived = StatCounters.BytesReceived.load(std::memory_order_relaxed);
+    Stats.BytesSent = StatCounters.BytesSent.load(std::memory_order_relaxed);
+    Stats.PacketsReceived = StatCounters.PacketsReceived.load(std::memory_order_relaxed);
+    Stats.PacketsSent = StatCounters.PacketsSent.load(std::memory_order_relaxed);
+    Stats.CommandsDispatched = StatCounters.CommandsDispatched.load(std::memory_order_relaxed);
+    Stats.CommandsRateLimited = StatCounters.CommandsRateLimited.load(std::memory_order_relaxed);
+    Stats.RequestsTimedOut = StatCounters.RequestsTimedOut.load(std::memory_order_relaxed);
+    Stats.ConnectionsAccepted = StatCounters.ConnectionsAccepted.load(std::memory_order_relaxed);
+    Stats.ConnectionsRefused = StatCounters.ConnectionsRefused.load(std::memory_order_relaxed);
+    Stats.ConnectionsRejected = StatCounters.ConnectionsRejected.load(std::memory_order_relaxed);
+    Stats.AuthFailures = StatCounters.AuthFailures.load(std::memory_order_relaxed);
+    Stats.ActiveConnections = StatCounters.ActiveConnections.load(std::memory_order_relaxed);
+    Stats.PendingRequests = PendingRequests.Num();
+
+    for (const uint16 Slot : ReadyCommandQueues)
+        Stats.QueuedCommands += CommandQueues[Slot].Events.Num() - CommandQueues[Slot].Head;
+
+    for (int32 Slot = 0; SendBacklogs && Slot < Settings.MaxActiveConnections; ++Slot)
+        Stats.SendBacklog += SendBacklogs[Slot].load(std::memory_order_relaxed);
+
+    return Stats;
+}
+
+int32 FRConServer::GetRequestPrincipal(const int32 RequestId) const
+{
+    const FPendingRequest* Request = FindRequest(RequestId);
+    const int32* Principal = Request ? ConnectionPrincipals.Find(Request->ConnectionId) : nullptr;
+    return Principal ? *Principal : INDEX_NONE;
+}
+
+ERConResponseFormat FRConServer::GetResponseFormat(const int32 RequestId) const
+{
+    const FPendingRequest* Request = FindRequest(RequestId);
+    const ERConResponseFormat* Format = Request ? ResponseFormats.Find(Request->ConnectionId) : nullptr;
+    return Format ? *Format : ERConResponseFormat::Text;
+}
+
+void FRConServer::SetResponseFormat(const int32 RequestId, ERConResponseFormat Format)
+{
+    const FPendingRequest* Request = FindRequest(RequestId);
+    if (!Request)
+        return;
+
+    if (Format == ERConResponseFormat::Text)
+        ResponseFormats.Remove(Request->ConnectionId);
+    else
+        ResponseFormats.Add(Request->ConnectionId, Format);
 }
 
 ISocketSubsystem* FRConServer::GetSocketSubsystem()
@@ -123,198 +363,923 @@ ISocketSubsystem* FRConServer::GetSocketSubsystem()
     return ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
 }
 
-bool FRConServer::CheckConnection(FClientConnection& Connection)
+FUniqueSocket FRConServer::CreateListenSocket(FInternetAddr& Address, const FSettings& InSettings, int32 PortCount)
 {
-    if (!Connection.Socket)
-        return false;
+    auto SocketSubsystem = GetSocketSubsystem();
 
-    uint32 PendingDataSize{};
-    const bool bHasPendingData = Connection.Socket->HasPendingData(PendingDataSize);
+    FUniqueSocket NewSocket = SocketSubsystem->CreateUniqueSocket(NAME_Stream, TEXT("RConServer"));
 
-    int32 BytesRead{};
-    const bool bRecvOk = Connection.Socket->Recv(nullptr, 0, BytesRead);
+    // accept loop relies on Accept returning immediately, when there is no pending connection
+    const bool bBlocking = NewSocket->SetNonBlocking();
+    if (!bBlocking)
+    {
+        UE_LOG(RConServer, Error, TEXT("Failed SetNonBlocking for listen socket"))
+        return nullptr;
+    }
 
-    return bHasPendingData || bRecvOk;
+    // on unix also sets SO_REUSEPORT, letting several processes listen on same port
+    const bool bReuse = NewSocket->SetReuseAddr(InSettings.bAllowPortReuse);
+    if (!bReuse)
+        UE_LOG(RConServer, Warning, TEXT("Failed SetReuseAddr for listen socket"))
+
+    const int32 NewBoundPort = SocketSubsystem->BindNextPort(NewSocket.Get(), Address, PortCount, 1);
+    if (NewBoundPort == 0)
+    {
+        UE_LOG(RConServer, Error, TEXT("Failed bind to address: %s"), *Address.ToString(true))
+        return nullptr;
+    }
+    Address.SetPort(NewBoundPort);
+
+    const bool bListen = NewSocket->Listen(InSettings.ListenBacklog);
+    if (!bListen)
+    {
+        UE_LOG(RConServer, Error, TEXT("Failed start listen with bind address: %s"), *Address.ToString(true))
+        return nullptr;
+    }
+
+    return NewSocket;
 }
 
-void FRConServer::ProcessNewConnections()
+void FRConServer::TickNetwork(uint32 WaitTime)
 {
-    bool bPending{};
-    if (ListenSocket->HasPendingConnection(bPending) && bPending)
+    // only sockets with events reported, idle connections cost nothing
+    ReadyKeys.Reset();
+    Poller->Wait(WaitTime, ReadyKeys);
+
+    // after wait, so network thread blocked on poller is not counted
+    SCOPE_CYCLE_COUNTER(STAT_RConServerTickNetwork);
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConServer::TickNetwork);
+
+    for (const uint32 Key : ReadyKeys)
     {
-        TSharedPtr<FSocket> NewClientSocket = TSharedPtr<FSocket>(ListenSocket->Accept(TEXT("RConClient")));
-        if (!NewClientSocket.IsValid())
-            return;
+        if (Key == ListenSocketKey || Key == LoopbackListenSocketKey)
+        {
+            ProcessNewConnections(Key == ListenSocketKey ? ListenSocket.Get() : LoopbackListenSocket.Get());
+            continue;
+        }
+
+        FClientConnection* Connection = FindConnection(Key);
+        if (Connection && Connection->Socket && !Connection->bReadPaused)
+            ProcessIncoming(*Connection);
+    }
+
+    CloseUnauthenticatedConnections(FPlatformTime::Seconds());
+
+    FlushOutgoing();
+}
+
+void FRConServer::FlushOutgoing()
+{
+    SCOPE_CYCLE_COUNTER(STAT_RConServerProcessOutgoing);
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConServer::FlushOutgoing);
+
+    FOutgoingResponse Response{};
+    while (OutgoingResponses.Dequeue(Response))
+    {
+        FClientConnection* Connection = FindConnection(Response.ConnectionId);
+        if (Connection && Connection->Socket)
+            EnqueueResponse(*Connection, Response.PacketId, ERConPacketType::ResponseValue, Response.Body);
+    }
+
+    // backwards, closing connection swaps last live slot into current position
+    for (int32 i = LiveSlots.Num() - 1; i > -1; --i)
+    {
+        FClientConnection& Connection = ConnectionSlots[LiveSlots[i]];
+        ProcessOutcoming(Connection);
+        if (Connection.Socket)
+            UpdateWriteInterest(Connection);
+    }
+
+    // lets game thread hold back streamed data from clients that don't keep up
+    for (const uint16 Slot : LiveSlots)
+        SendBacklogs[Slot].store(GetSendBacklog(ConnectionSlots[Slot]), std::memory_order_relaxed);
+}
+
+FRConServer::FClientConnection* FRConServer::FindConnection(uint32 ConnectionId)
+{
+    const int32 Slot = ConnectionId & 0xFFFF;
+    if (!ConnectionSlots.IsValidIndex(Slot))
+        return nullptr;
+
+    // stale id of closed connection has older generation than slot holds now
+    FClientConnection& Connection = ConnectionSlots[Slot];
+    return Connection.Id == ConnectionId ? &Connection : nullptr;
+}
 
-        auto IncomingAddr = GetSocketSubsystem()->CreateInternetAddr();
-        NewClientSocket->GetPeerAddress(*IncomingAddr);
+const FRConServer::FPendingRequest* FRConServer::FindRequest(int32 RequestId) const
+{
+    // request being dispatched is not in PendingRequests yet
+    return RequestId == DispatchingRequestId ? &DispatchingRequest : PendingRequests.Find(RequestId);
+}
 
-        if (ActiveConnections >= Settings.MaxActiveConnections)
+void FRConServer::DispatchIncomingEvents()
+{
+    FIncomingEvent Event{};
+    while (IncomingEvents.Dequeue(Event))
+    {
+        switch (Event.Type)
         {
-            NewClientSocket->Shutdown(ESocketShutdownMode::ReadWrite);
-            NewClientSocket->Close();
+        case EIncomingEventType::Authenticated:
+            ConnectionPrincipals.Add(Event.ConnectionId, Event.Principal);
+            ClientConnectedCallback.ExecuteIfBound();
+            break;
+        case EIncomingEventType::Disconnected:
+            RemoveConnectionCommands(Event.ConnectionId);
+            RemoveConnectionRequests(Event.ConnectionId);
+            ResponseFormats.Remove(Event.ConnectionId);
+            ConnectionPrincipals.Remove(Event.ConnectionId);
+            break;
+        case EIncomingEventType::Command:
+        case EIncomingEventType::Terminator:
+        case EIncomingEventType::RateLimited:
+            QueueCommand(MoveTemp(Event));
+            break;
+        }
+    }
 
-            UE_LOG(RConServer, Warning, TEXT("Refusing \'%s\' connection, max active connection limit of %d reached"), *IncomingAddr->ToString(true), Settings.MaxActiveConnections)
-            return;
+    DispatchQueuedCommands();
+}
+
+void FRConServer::QueueCommand(FIncomingEvent&& Event)
+{
+    const uint16 Slot = static_cast<uint16>(Event.ConnectionId & 0xFFFF);
+    FCommandQueue& Queue = CommandQueues[Slot];
+
+    if (Queue.Head == Queue.Events.Num())
+    {
+        Queue.ConnectionId = Event.ConnectionId;
+        Queue.Events.Reset();
+        Queue.Head = 0;
+        ReadyCommandQueues.Add(Slot);
+    }
+    Queue.Events.Add(MoveTemp(Event));
+}
+
+void FRConServer::RemoveConnectionCommands(uint32 ConnectionId)
+{
+    const uint16 Slot = static_cast<uint16>(ConnectionId & 0xFFFF);
+    FCommandQueue& Queue = CommandQueues[Slot];
+    if (Queue.ConnectionId != ConnectionId || Queue.Head == Queue.Events.Num())
+        return;
+
+    Queue.Events.Reset();
+    Queue.Head = 0;
+
+    const int32 Index = ReadyCommandQueues.Find(Slot);
+    ReadyCommandQueues.RemoveAt(Index, EAllowShrinking::No);
+    if (NextReadyCommandQueue > Index)
+        --NextReadyCommandQueue;
+}
+
+void FRConServer::DispatchQueuedCommands()
+{
+    SCOPE_CYCLE_COUNTER(STAT_RConServerDispatchCommands);
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConServer::DispatchQueuedCommands);
+
+    const double Deadline = FPlatformTime::Seconds() + Settings.CommandTimeBudgetMs / 1000.0;
+    int32 NumDispatched{};
+
+    // one command per connection at a time, so single busy client can't starve others. Leftovers wait for next tick
+    while (bStarted && ReadyCommandQueues.Num())
+    {
+        if (NextReadyCommandQueue >= ReadyCommandQueues.Num())
+            NextReadyCommandQueue = 0;
+
+        FCommandQueue& Queue = CommandQueues[ReadyCommandQueues[NextReadyCommandQueue]];
+        FIncomingEvent Event = MoveTemp(Queue.Events[Queue.Head++]);
+
+        if (Queue.Head == Queue.Events.Num())
+        {
+            Queue.Events.Reset();
+            Queue.Head = 0;
+            ReadyCommandQueues.RemoveAt(NextReadyCommandQueue, EAllowShrinking::No);
+        }
+        else
+        {
+            ++NextReadyCommandQueue;
+        }
+
+        if (Event.Type == EIncomingEventType::Terminator)
+        {
+            // goes same route as command responses, so it never overtakes them
+            EnqueueOutgoing(Event.ConnectionId, Event.PacketId, FString());
+            continue;
+        }
+        if (Event.Type == EIncomingEventType::RateLimited)
+        {
+            EnqueueOutgoing(Event.ConnectionId, Event.PacketId, TEXT("Command rate limit exceeded, command dropped"));
+            continue;
+        }
+
+        DispatchCommand(Event);
+
+        ++NumDispatched;
+        if (Settings.MaxCommandsPerTick > 0 && NumDispatched >= Settings.MaxCommandsPerTick)
+            break;
+        if (Settings.CommandTimeBudgetMs > 0.0 && FPlatformTime::Seconds() >= Deadline)
+            break;
+    }
+}
+
+void FRConServer::DispatchCommand(FIncomingEvent& Event)
+{
+    const int32 RequestId = static_cast<int32>(++LastRequestId);
+    StatCounters.CommandsDispatched.fetch_add(1, std::memory_order_relaxed);
+
+    bool bDelayResponse{};
+    FString Response{};
+
+    DispatchingRequestId = RequestId;
+    DispatchingRequest = FPendingRequest{Event.ConnectionId, Event.PacketId};
+
+    if (!ExecCommandCallback.ExecuteIfBound(RequestId, Event.Body, Response, bDelayResponse))
+    {
+        Response = FString::Printf(TEXT("Failed to execute: %s (no command callback is bound)"), *Event.Body);
+    }
+
+    DispatchingRequestId = INDEX_NONE;
+
+    if (bDelayResponse)
+    {
+        // map only delayed responses, since it will require figure out real packet id
+        PendingRequests.Add(RequestId, DispatchingRequest);
+
+        if (Settings.DelayedResponseTimeout > 0.0 && !DispatchingRequest.bKeepOpen)
+            PendingRequestDeadlines.Enqueue(TPair<int32, double>(RequestId, FPlatformTime::Seconds() + Settings.DelayedResponseTimeout));
+    }
+    else
+    {
+        EnqueueOutgoing(Event.ConnectionId, Event.PacketId, MoveTemp(Response));
+    }
+}
+
+void FRConServer::RemoveConnectionRequests(uint32 ConnectionId)
+{
+    for (auto It = PendingRequests.CreateIterator(); It; ++It)
+    {
+        if (It.Value().ConnectionId == ConnectionId)
+        {
+            const int32 RequestId = It.Key();
+            It.RemoveCurrent();
+            RequestCanceledCallback.ExecuteIfBound(RequestId);
+        }
+    }
+}
+
+void FRConServer::ExpirePendingRequests()
+{
+    const double Now = FPlatformTime::Seconds();
+
+    // completed requests are already gone from map, their deadlines just skipped
+    const TPair<int32, double>* Deadline{};
+    while ((Deadline = PendingRequestDeadlines.Peek()) && Deadline->Value <= Now)
+    {
+        const FPendingRequest* KeptRequest = PendingRequests.Find(Deadline->Key);
+        FPendingRequest Request{};
+        if (!(KeptRequest && KeptRequest->bKeepOpen) && PendingRequests.RemoveAndCopyValue(Deadline->Key, Request))
+        {
+            UE_LOG(RConServer, Warning, TEXT("Request %d timed out waiting for delayed response"), Deadline->Key);
+            StatCounters.RequestsTimedOut.fetch_add(1, std::memory_order_relaxed);
+            EnqueueOutgoing(Request.ConnectionId, Request.PacketId, TEXT("Request timed out"));
+            RequestCanceledCallback.ExecuteIfBound(Deadline->Key);
         }
+        PendingRequestDeadlines.Pop();
+    }
+}
+
+void FRConServer::PublishStats()
+{
+#if STATS
+    const FStats Stats = GetStats();
+
+    SET_DWORD_STAT(STAT_RConActiveConnections, Stats.ActiveConnections);
+    SET_DWORD_STAT(STAT_RConQueuedCommands, Stats.QueuedCommands);
+    SET_DWORD_STAT(STAT_RConPendingRequests, Stats.PendingRequests);
+    SET_DWORD_STAT(STAT_RConSendBacklog, Stats.SendBacklog);
+    INC_DWORD_STAT_BY(STAT_RConBytesReceived, Stats.BytesReceived - PublishedStats.BytesReceived);
+    INC_DWORD_STAT_BY(STAT_RConBytesSent, Stats.BytesSent - PublishedStats.BytesSent);
+    INC_DWORD_STAT_BY(STAT_RConPacketsReceived, Stats.PacketsReceived - PublishedStats.PacketsReceived);
+    INC_DWORD_STAT_BY(STAT_RConPacketsSent, Stats.PacketsSent - PublishedStats.PacketsSent);
+    INC_DWORD_STAT_BY(STAT_RConCommandsDispatched, Stats.CommandsDispatched - PublishedStats.CommandsDispatched);
+
+    PublishedStats = Stats;
+#endif
+}
+
+void FRConServer::EnqueueOutgoing(uint32 ConnectionId, int32 PacketId, FString Body)
+{
+    OutgoingResponses.Enqueue(FOutgoingResponse{ConnectionId, PacketId, MoveTemp(Body)});
+
+    if (NetworkThread)
+        Poller->Wake();
+}
+
+void FRConServer::ProcessNewConnections(FSocket* AcceptingSocket)
+{
+    static const FString ClientSocketDescription = TEXT("RConClient");
+
+    const double Now = FPlatformTime::Seconds();
+
+    // drain pending connections up to budget, rest picked up on next tick
+    for (int32 i = 0; i < Settings.MaxAcceptsPerTick; ++i)
+    {
+        FSocket* AcceptedSocket = AcceptingSocket->Accept(ClientSocketDescription);
+        if (!AcceptedSocket)
+            break;
+
+        // refusals and rejections could come in bursts, skip logging for each one
+        // cheapest checks go first, so flood of connections dropped anyway costs as little as possible
+        if (FreeSlots.IsEmpty())
+        {
+            AcceptedSocket->Close();
+            GetSocketSubsystem()->DestroySocket(AcceptedSocket);
+            ++RefusedConnections;
+            StatCounters.ConnectionsRefused.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        const bool bOverUnauthenticatedLimit = Settings.MaxUnauthenticatedConnections > 0 && UnauthenticatedConnections >= Settings.MaxUnauthenticatedConnections;
+
+        uint32 AddressHash{};
+        if (!bOverUnauthenticatedLimit)
+        {
+            // listen sockets are IPv4, port excluded so reconnects of same peer share record
+            uint32 PeerIp{};
+            AcceptedSocket->GetPeerAddress(*PeerAddress);
+            PeerAddress->GetIp(PeerIp);
+            AddressHash = FCrc::MemCrc32(&PeerIp, sizeof(PeerIp));
+        }
+
+        if (bOverUnauthenticatedLimit || IsAddressBanned(AddressHash, Now))
+        {
+            AcceptedSocket->Close();
+            GetSocketSubsystem()->DestroySocket(AcceptedSocket);
+            ++RejectedConnections;
+            StatCounters.ConnectionsRejected.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        TSharedPtr<FSocket> NewClientSocket = TSharedPtr<FSocket>(AcceptedSocket);
 
         const bool bBlocking = NewClientSocket->SetNonBlocking();
         if (!bBlocking)
             UE_LOG(RConServer, Warning, TEXT("Failed SetNonBlocking for client socket"))
 
-        auto& NewConnection = ClientConnections.Emplace_GetRef(MakeUnique<FClientConnection>());
-        NewConnection->Id = ++LastId;
+        FClientConnection* NewConnection = AcquireConnectionSlot();
+        StatCounters.ConnectionsAccepted.fetch_add(1, std::memory_order_relaxed);
+        StatCounters.ActiveConnections.store(LiveSlots.Num(), std::memory_order_relaxed);
         NewConnection->Socket = MoveTemp(NewClientSocket);
+        NewConnection->AddressHash = AddressHash;
+        NewConnection->AcceptTime = Now;
+        ++UnauthenticatedConnections;
+        Poller->Add(NewConnection->Socket.Get(), NewConnection->Id);
+
+        UE_LOG(RConServer, Log, TEXT("Accepting new client connection from \'%s\'. Assigned id: %u. Connection: %d out of %d"), *PeerAddress->ToString(true), NewConnection->Id, LiveSlots.Num(), Settings.MaxActiveConnections);
+    }
+
+    // summarize refusals at most once per second
+    if (Now - LastRefusedLogTime >= 1.0 && (RefusedConnections != LastLoggedRefusedConnections || RejectedConnections != LastLoggedRejectedConnections))
+    {
+        UE_CLOG(RefusedConnections != LastLoggedRefusedConnections, RConServer, Warning, TEXT("Refused %u connections, max active connection limit of %d reached"), RefusedConnections - LastLoggedRefusedConnections, Settings.MaxActiveConnections);
+        UE_CLOG(RejectedConnections != LastLoggedRejectedConnections, RConServer, Warning, TEXT("Rejected %u connections from banned addresses or over unauthenticated connection limit of %d"), RejectedConnections - LastLoggedRejectedConnections, Settings.MaxUnauthenticatedConnections);
+        LastLoggedRefusedConnections = RefusedConnections;
+        LastLoggedRejectedConnections = RejectedConnections;
+        LastRefusedLogTime = Now;
+    }
+}
+
+void FRConServer::ComputeCredentialDigest(const uint8* Salt, FStringView Password, uint8* OutDigest)
+{
+    const FTCHARToUTF8 Utf8Password(Password.GetData(), Password.Len());
+
+    FSHA1 Sha{};
+    Sha.Update(Salt, sizeof(FCredentialDigest::Salt));
+    Sha.Update(reinterpret_cast<const uint8*>(Utf8Password.Get()), Utf8Password.Length());
+    Sha.Final();
+    Sha.GetHash(OutDigest);
+}
+
+int32 FRConServer::FindPrincipal(FStringView Password) const
+{
+    int32 FoundPrincipal = INDEX_NONE;
+    for (int32 Principal = 0; Principal < CredentialDigests.Num(); ++Principal)
+    {
+        const FCredentialDigest& CredentialDigest = CredentialDigests[Principal];
+
+        uint8 Digest[FSHA1::DigestSize];
+        ComputeCredentialDigest(CredentialDigest.Salt, Password, Digest);
+
+        uint8 Difference{};
+        for (int32 i = 0; i < FSHA1::DigestSize; ++i)
+            Difference |= Digest[i] ^ CredentialDigest.Digest[i];
+
+        if (Difference == 0 && FoundPrincipal == INDEX_NONE)
+            FoundPrincipal = Principal;
+    }
+    return FoundPrincipal;
+}
+
+bool FRConServer::IsAddressBanned(uint32 AddressHash, double Now)
+{
+    const FAddressRecord* Record = FindAddressRecord(AddressHash, false);
+    return Record && Record->BanEndTime > Now;
+}
+
+FRConServer::FAddressRecord* FRConServer::FindAddressRecord(uint32 AddressHash, bool bAdd)
+{
+    if (AddressRecords.IsEmpty())
+        return nullptr;
+
+    FAddressRecord* OldestRecord = nullptr;
+    for (int32 i = 0; i < AddressTableProbes; ++i)
+    {
+        FAddressRecord& Record = AddressRecords[(AddressHash + i) & (AddressTableSize - 1)];
+        if (Record.AddressHash == AddressHash && Record.LastUpdateTime > 0.0)
+            return &Record;
+        if (!OldestRecord || Record.LastUpdateTime < OldestRecord->LastUpdateTime)
+            OldestRecord = &Record;
+    }
+
+    if (!bAdd)
+        return nullptr;
+
+    // table is bounded, address not heard of for longest time is forgotten
+    *OldestRecord = FAddressRecord{AddressHash};
+    return OldestRecord;
+}
+
+void FRConServer::RecordAuthFailure(FClientConnection& Connection, double Now)
+{
+    StatCounters.AuthFailures.fetch_add(1, std::memory_order_relaxed);
 
-        ActiveConnections++;
+    FAddressRecord* Record = FindAddressRecord(Connection.AddressHash, true);
+    if (!Record)
+        return;
 
-        UE_LOG(RConServer, Log, TEXT("Accepting new client connection from \'%s\'. Assigned id: %d. Connection: %d out of %d"), *IncomingAddr->ToString(true), LastId, ActiveConnections, Settings.MaxActiveConnections);
+    if (Settings.AuthFailureDecayTime > 0.0)
+        Record->FailureScore = FMath::Max(0.0, Record->FailureScore - (Now - Record->LastUpdateTime) / Settings.AuthFailureDecayTime);
+    Record->FailureScore += 1.0;
+    Record->LastUpdateTime = Now;
+
+    if (Record->FailureScore >= Settings.MaxAuthFailures)
+    {
+        UE_LOG(RConServer, Warning, TEXT("Address of client %u banned for %.0f seconds after %d failed logins"), Connection.Id, Settings.AuthBanTime, Settings.MaxAuthFailures);
+        Record->BanEndTime = Now + Settings.AuthBanTime;
+        Record->FailureScore = 0.0;
     }
 }
 
-void FRConServer::TryPurgeOldConnections()
+void FRConServer::CloseUnauthenticatedConnections(double Now)
 {
-    for (int32 i = ClientConnections.Num() - 1; i > -1; --i)
+    if (UnauthenticatedConnections == 0 || Settings.AuthTimeout <= 0.0)
+        return;
+
+    // backwards, closing connection swaps last live slot into current position
+    for (int32 i = LiveSlots.Num() - 1; i > -1; --i)
     {
-        const auto& Connection = ClientConnections[i];
-        if (!Connection->Socket.IsValid())
+        FClientConnection& Connection = ConnectionSlots[LiveSlots[i]];
+        if (!Connection.bAuthorized && Now - Connection.AcceptTime > Settings.AuthTimeout)
         {
-            UE_LOG(RConServer, Verbose, TEXT("Client %d connection purged"), Connection->Id);
-            ClientConnections.RemoveAt(i, EAllowShrinking::No);
+            UE_LOG(RConServer, Warning, TEXT("Client %u did not authenticate within %.1f seconds, closing connection"), Connection.Id, Settings.AuthTimeout);
+            RecordAuthFailure(Connection, Now);
+            CloseConnection(Connection);
         }
     }
 }
 
+FRConServer::FClientConnection* FRConServer::AcquireConnectionSlot()
+{
+    const uint16 Slot = FreeSlots.Pop(EAllowShrinking::No);
+    LiveSlots.Add(Slot);
+
+    FClientConnection& Connection = ConnectionSlots[Slot];
+    if (++Connection.Generation == 0)
+        Connection.Generation = 1; // keeps ids from colliding with listen socket keys
+    Connection.Id = (static_cast<uint32>(Connection.Generation) << 16) | Slot;
+
+    // buffers keep their allocations from previous client
+    Connection.bAuthorized = false;
+    Connection.CommandTokens = Settings.CommandRateBurst;
+    Connection.LastTokenRefillTime = FPlatformTime::Seconds();
+    Connection.SendOverflow.Reset();
+    Connection.SendOverflowOffset = 0;
+    Connection.bReadPaused = false;
+    Connection.bWriteInterest = false;
+    if (Connection.SendBuffer.GetCapacity() == 0)
+    {
+        // fit at least two max sized packets, so one never waits for the other to be sent
+        Connection.SendBuffer.Init(FMath::Max(Settings.MaxSendBufferSize, 2 * FRConPacket::GetSerializedSize(Settings.MaxResponseBodySize)));
+    }
+    else
+    {
+        Connection.SendBuffer.Reset();
+    }
+    if (Connection.RecvBuffer.GetCapacity() == 0)
+    {
+        // fit at least two max sized packets, so partial one never blocks receiving
+        Connection.RecvBuffer.Init(2 * (Settings.MaxPacketSize + CRConPacketSizeFieldLength));
+    }
+    else
+    {
+        Connection.RecvBuffer.Reset();
+    }
+
+    return &Connection;
+}
+
 void FRConServer::ProcessIncoming(FClientConnection& Connection)
 {
-    TArray<uint8> RecvBuffer{};
+    SCOPE_CYCLE_COUNTER(STAT_RConServerProcessIncoming);
+    TRACE_CPUPROFILER_EVENT_SCOPE(FRConServer::ProcessIncoming);
+
+    FRConRingBuffer& RecvBuffer = Connection.RecvBuffer;
 
-    uint32 PendingDataSize{};
-    while (Connection.Socket && Connection.Socket->HasPendingData(PendingDataSize))
+    while (Connection.Socket)
     {
-        RecvBuffer.SetNumUninitialized(PendingDataSize);
+        int32 RegionSize{};
+        uint8* Region = RecvBuffer.GetWriteRegion(RegionSize);
+        if (RegionSize == 0)
+            return;
 
+        // non-blocking recv fails only when peer closed connection or on error, no data is not a failure
         int32 BytesRead{};
-        const bool bRecvOk = Connection.Socket->Recv(RecvBuffer.GetData(), RecvBuffer.Num(), BytesRead);
+        const bool bRecvOk = Connection.Socket->Recv(Region, RegionSize, BytesRead);
         if (!bRecvOk)
+        {
+            UE_LOG(RConServer, Log, TEXT("Client %u disconnected"), Connection.Id);
+            CloseConnection(Connection);
             return;
+        }
 
-        if (BytesRead < CRConBasePacketSize)
+        if (BytesRead == 0)
             return;
 
-        const auto [bPacketOk, Packet] = FRConPacket::DeserializePacket(RecvBuffer.GetData(), RecvBuffer.Num());
-        if (!bPacketOk)
-            continue;
+        RecvBuffer.Commit(BytesRead);
+        StatCounters.BytesReceived.fetch_add(BytesRead, std::memory_order_relaxed);
+        ProcessReceivedPackets(Connection);
+
+        // socket drained, otherwise free region was too small and there could be more data
+        if (BytesRead < RegionSize)
+            return;
+    }
+}
+
+void FRConServer::ProcessReceivedPackets(FClientConnection& Connection)
+{
+    FRConRingBuffer& RecvBuffer = Connection.RecvBuffer;
+    FRConPacket Packet{};
 
-        ++LastRequestId;
+    while (Connection.Socket && RecvBuffer.Num() >= CRConPacketSizeFieldLength)
+    {
+        int32 PacketSize{};
+        RecvBuffer.Peek(reinterpret_cast<uint8*>(&PacketSize), CRConPacketSizeFieldLength);
+        PacketSize = INTEL_ORDER32(PacketSize);
 
-        if (Packet.Type == ERConPacketType::Auth)
+        if (PacketSize < CRConMinPacketSize || PacketSize > Settings.MaxPacketSize)
         {
-            const bool bAuthSuccess = Settings.Password.Equals(Packet.Body, ESearchCase::CaseSensitive);
+            UE_LOG(RConServer, Warning, TEXT("Client %u sent malformed packet with size %d, closing connection"), Connection.Id, PacketSize);
+            CloseConnection(Connection);
+            return;
+        }
 
-            const int32 AuthId = bAuthSuccess ? Packet.Id : -1;
-            EnqueueResponse(Connection, AuthId, ERConPacketType::AuthResponse, FString());
+        const int32 FrameSize = PacketSize + CRConPacketSizeFieldLength;
+        if (RecvBuffer.Num() < FrameSize)
+            return; // wait for the rest of the packet
 
-            if (bAuthSuccess)
-            {
-                UE_LOG(RConServer, Log, TEXT("Client %d authenticated"), Connection.Id);
-                Connection.bAuthorized = true;
-                ClientConnectedCallback.ExecuteIfBound();
-            }
-            else
-            {
-                UE_LOG(RConServer, Warning, TEXT("Client %d authentication failure"), Connection.Id);
-                CloseConnection(Connection);
-            }
+        const uint8* FrameData = RecvBuffer.Linearize(FrameSize, Connection.RecvScratch);
+        const bool bPacketOk = FRConPacket::DeserializePacket(FrameData, FrameSize, Packet, Settings.MaxPacketSize);
+        RecvBuffer.Consume(FrameSize);
+
+        StatCounters.PacketsReceived.fetch_add(1, std::memory_order_relaxed);
+        if (bPacketOk)
+            ProcessPacket(Connection, Packet);
+        else
+            UE_LOG(RConServer, Warning, TEXT("Client %u sent packet with invalid body, packet dropped"), Connection.Id);
+    }
+}
+
+void FRConServer::ProcessPacket(FClientConnection& Connection, FRConPacket& Packet)
+{
+    if (Packet.Type == ERConPacketType::Auth)
+    {
+        const int32 Principal = FindPrincipal(Packet.Body);
+        const bool bAuthSuccess = Principal != INDEX_NONE;
+
+        const int32 AuthId = bAuthSuccess ? Packet.Id : -1;
+        EnqueueResponse(Connection, AuthId, ERConPacketType::AuthResponse, FString());
+
+        if (bAuthSuccess)
+        {
+            UE_LOG(RConServer, Log, TEXT("Client %u authenticated as %s"), Connection.Id, Principal == 0 ? TEXT("admin") : *Settings.Credentials[Principal - 1].Name);
+            if (!Connection.bAuthorized)
+                --UnauthenticatedConnections;
+            Connection.bAuthorized = true;
+            Connection.Principal = Principal;
+            // mistyped password of real admin is not held against them
+            if (FAddressRecord* Record = FindAddressRecord(Connection.AddressHash, false))
+                Record->FailureScore = 0.0;
+            IncomingEvents.Enqueue(FIncomingEvent{EIncomingEventType::Authenticated, Connection.Id, Packet.Id, FString(), Principal});
         }
-        else if (Packet.Type == ERConPacketType::ExecCommand)
+        else
         {
-            if (!Connection.Socket.IsValid())
-            {
-                UE_LOG(RConServer, Warning, TEXT("Client %d attempt to execute command without authentication"), Connection.Id);
-                continue;
-            }
+            UE_LOG(RConServer, Warning, TEXT("Client %u authentication failure"), Connection.Id);
+            RecordAuthFailure(Connection, FPlatformTime::Seconds());
+            CloseConnection(Connection);
+        }
+    }
+    else if (Packet.Type == ERConPacketType::ExecCommand)
+    {
+        if (!Connection.bAuthorized)
+        {
+            UE_LOG(RConServer, Warning, TEXT("Client %u attempt to execute command without authentication"), Connection.Id);
+            return;
+        }
 
-            UE_LOG(RConServer, Log, TEXT("Client %d received command: %s"), Connection.Id, *Packet.Body);
+        if (!TryConsumeCommandToken(Connection))
+        {
+            UE_LOG(RConServer, Warning, TEXT("Client %u exceeded command rate limit, command dropped: %s"), Connection.Id, *Packet.Body);
+            StatCounters.CommandsRateLimited.fetch_add(1, std::memory_order_relaxed);
+            // written directly, rejection would overtake responses of commands still queued before it
+            IncomingEvents.Enqueue(FIncomingEvent{EIncomingEventType::RateLimited, Connection.Id, Packet.Id, FString()});
+            return;
+        }
 
-            bool bDelayResponse{};
-            FString Response{};
+        UE_LOG(RConServer, Log, TEXT("Client %u received command: %s"), Connection.Id, *Packet.Body);
 
-            if (!ExecCommandCallback.ExecuteIfBound(LastRequestId, Packet.Body, Response, bDelayResponse))
-            {
-                Response = FString::Printf(TEXT("Failed to execute: %s (no command callback is bound)"), *Packet.Body);
-            }
+        IncomingEvents.Enqueue(FIncomingEvent{EIncomingEventType::Command, Connection.Id, Packet.Id, MoveTemp(Packet.Body)});
+    }
+    else if (Packet.Type == ERConPacketType::ResponseValue && Connection.bAuthorized)
+    {
+        // multi-packet response terminator trick, client sends empty response value after a command
+        // and once mirrored back, it knows all packets of that command response were received
+        IncomingEvents.Enqueue(FIncomingEvent{EIncomingEventType::Terminator, Connection.Id, Packet.Id, FString()});
+    }
+}
 
-            if (bDelayResponse)
-            {
-                // map only delayed responses, since it will require figure out real packet id
-                Connection.RequestIdMapping.Emplace(TPair<int32, int32>(LastRequestId, Packet.Id));
-            }
-            else
+bool FRConServer::TryConsumeCommandToken(FClientConnection& Connection)
+{
+    if (Settings.CommandRateLimit <= 0.0)
+        return true;
+
+    const double Now = FPlatformTime::Seconds();
+    const double Elapsed = Now - Connection.LastTokenRefillTime;
+    Connection.LastTokenRefillTime = Now;
+    Connection.CommandTokens = FMath::Min(Connection.CommandTokens + Elapsed * Settings.CommandRateLimit, static_cast<double>(FMath::Max(Settings.CommandRateBurst, 1)));
+
+    if (Connection.CommandTokens < 1.0)
+        return false;
+
+    Connection.CommandTokens -= 1.0;
+    return true;
+}
+
+void FRConServer::ProcessOutcoming(FClientConnection& Connection)
+{
+    FRConRingBuffer& SendBuffer = Connection.SendBuffer;
+
+    // second pass sends part of ring that wrapped around, or overflow moved in after first one
+    while (Connection.Socket && !SendBuffer.IsEmpty())
+    {
+        int32 RegionSize{};
+        const uint8* Region = SendBuffer.GetReadRegion(RegionSize);
+
+        int32 BytesSent{};
+        const bool bSendOk = Connection.Socket->Send(Region, RegionSize, BytesSent);
+        if (!bSendOk)
+        {
+            const ESocketErrors ErrorCode = GetSocketSubsystem()->GetLastErrorCode();
+            if (ErrorCode != SE_EWOULDBLOCK)
             {
-                EnqueueResponse(Connection, Packet.Id, ERConPacketType::ResponseValue, Response);
+                // paused connection is not read, so this is the only place to notice it is gone
+                UE_LOG(RConServer, Error, TEXT("Failed to send response to client %u, error code %i"), Connection.Id, static_cast<int32>(ErrorCode));
+                CloseConnection(Connection);
             }
+            return;
         }
+
+        SendBuffer.Consume(BytesSent);
+        StatCounters.BytesSent.fetch_add(BytesSent, std::memory_order_relaxed);
+
+        if (HasSendOverflow(Connection))
+            RefillSendBuffer(Connection);
+
+        // socket buffer is full, rest resumed once poller reports socket writable
+        if (BytesSent < RegionSize)
+            return;
     }
 }
 
-void FRConServer::ProcessOutcoming(FClientConnection& Connection)
+void FRConServer::UpdateWriteInterest(FClientConnection& Connection)
+{
+    // socket buffer is full, network thread wakes once it frees up instead of waiting out NetworkThreadWaitTime
+    const bool bWantWrite = !Connection.SendBuffer.IsEmpty();
+    if (bWantWrite != Connection.bWriteInterest)
+    {
+        Poller->Modify(Connection.Socket.Get(), Connection.Id, !Connection.bReadPaused, bWantWrite);
+        Connection.bWriteInterest = bWantWrite;
+    }
+}
+
+void FRConServer::CloseConnection(FClientConnection& Connection)
+{
+    if (Connection.Socket.IsValid())
+    {
+        Poller->Remove(Connection.Socket.Get(), Connection.Id);
+        CloseSpillFile(Connection);
+        if (!Connection.bAuthorized)
+            --UnauthenticatedConnections;
+        Connection.Socket->Shutdown(ESocketShutdownMode::ReadWrite);
+        Connection.Socket->Close();
+        Connection.Socket.Reset();
+
+        IncomingEvents.Enqueue(FIncomingEvent{EIncomingEventType::Disconnected, Connection.Id, 0, FString()});
+
+        const uint16 Slot = static_cast<uint16>(Connection.Id & 0xFFFF);
+        LiveSlots.RemoveSingleSwap(Slot, EAllowShrinking::No);
+        FreeSlots.Add(Slot);
+        SendBacklogs[Slot].store(0, std::memory_order_relaxed);
+        StatCounters.ActiveConnections.store(LiveSlots.Num(), std::memory_order_relaxed);
+    }
+}
+
+void FRConServer::EnqueueResponse(FClientConnection& Connection, int32 RequestId, ERConPacketType Type, FStringView Payload)
 {
-    if (!Connection.Socket)
+    UE_LOG(RConServer, Verbose, TEXT("Enqueue response: Type %d, Id %d, Body %.*s"), (int32)Type, RequestId, Payload.Len(), Payload.GetData());
+
+    // fast path, even worst case UTF-8 expansion fits into single packet
+    if (Payload.Len() * 4 <= Settings.MaxResponseBodySize)
+    {
+        EnqueuePacket(Connection, RequestId, Type, Payload);
         return;
+    }
 
-    while (!Connection.SendQueue.IsEmpty())
+    // split into several packets with same id, serialized directly from views into payload
+    // overflow policy may close connection halfway through
+    while (Connection.Socket && !Payload.IsEmpty())
     {
-        FRConPacket Packet;
-        Connection.SendQueue.Peek(Packet);
-        if (SendPacket(Connection.Socket, Packet))
+        const int32 ChunkLength = FMath::Max(1, FRConPacket::GetBodyChunkLength(Payload, Settings.MaxResponseBodySize));
+        EnqueuePacket(Connection, RequestId, Type, Payload.Left(ChunkLength));
+        Payload.RightChopInline(ChunkLength);
+    }
+}
+
+void FRConServer::EnqueuePacket(FClientConnection& Connection, int32 Id, ERConPacketType Type, FStringView Body)
+{
+    StatCounters.PacketsSent.fetch_add(1, std::memory_order_relaxed);
+
+    // straight into ring, unless packet wraps around its end or older overflow has to go first
+    if (!HasSendOverflow(Connection))
+    {
+        int32 RegionSize{};
+        uint8* Region = Connection.SendBuffer.GetWriteRegion(RegionSize);
+        const int32 BytesWritten = FRConPacket::SerializePacket(Region, RegionSize, Id, Type, Body);
+        if (BytesWritten)
         {
-            Connection.SendQueue.Pop();
+            Connection.SendBuffer.Commit(BytesWritten);
+            return;
         }
-        else
+    }
+
+    SendScratch.Reset();
+    FRConPacket::SerializePacket(SendScratch, Id, Type, Body);
+    if (HasSendOverflow(Connection) || !Connection.SendBuffer.Write(SendScratch.GetData(), SendScratch.Num()))
+        EnqueueOverflow(Connection, SendScratch.GetData(), SendScratch.Num());
+}
+
+void FRConServer::EnqueueOverflow(FClientConnection& Connection, const uint8* Data, int32 Size)
+{
+    switch (Settings.SendOverflowPolicy)
+    {
+    case ESendOverflowPolicy::StopReading:
+        // commands already read still respond, exec output of single one could be any size
+        if (Connection.SendOverflow.Num() - Connection.SendOverflowOffset + Size > Settings.MaxSendBufferSize)
         {
+            UE_LOG(RConServer, Warning, TEXT("Client %u does not keep up with responses, overflow exceeds %d bytes, closing connection"), Connection.Id, Settings.MaxSendBufferSize);
+            CloseConnection(Connection);
             break;
         }
+        Connection.SendOverflow.Append(Data, Size);
+        if (!Connection.bReadPaused)
+        {
+            UE_LOG(RConServer, Log, TEXT("Client %u does not keep up with responses, pausing reading from it"), Connection.Id);
+            Poller->Modify(Connection.Socket.Get(), Connection.Id, false, Connection.bWriteInterest);
+            Connection.bReadPaused = true;
+        }
+        break;
+    case ESendOverflowPolicy::Disconnect:
+        UE_LOG(RConServer, Warning, TEXT("Client %u does not keep up with responses, closing connection"), Connection.Id);
+        CloseConnection(Connection);
+        break;
+    case ESendOverflowPolicy::SpillToDisk:
+        if (!SpillToDisk(Connection, Data, Size))
+            CloseConnection(Connection);
+        break;
     }
 }
 
-bool FRConServer::SendPacket(TSharedPtr<FSocket>& Socket, const FRConPacket& Packet)
+void FRConServer::RefillSendBuffer(FClientConnection& Connection)
 {
-    if (!Socket)
-        return false;
+    FRConRingBuffer& SendBuffer = Connection.SendBuffer;
 
-    const TArray<uint8> Data = Packet.Serialize();
-    int32 BytesSent{};
+    if (Connection.SendOverflowOffset < Connection.SendOverflow.Num())
+    {
+        const int32 Count = FMath::Min(SendBuffer.GetSlack(), Connection.SendOverflow.Num() - Connection.SendOverflowOffset);
+        SendBuffer.Write(Connection.SendOverflow.GetData() + Connection.SendOverflowOffset, Count);
+        Connection.SendOverflowOffset += Count;
 
-    const bool bSendOk = Socket->Send(Data.GetData(), Data.Num(), BytesSent);
+        if (Connection.SendOverflowOffset == Connection.SendOverflow.Num())
+        {
+            Connection.SendOverflow.Reset();
+            Connection.SendOverflowOffset = 0;
+        }
+    }
+
+    while (Connection.SpillReadOffset < Connection.SpillWriteOffset && SendBuffer.GetSlack() > 0)
+    {
+        int32 RegionSize{};
+        uint8* Region = SendBuffer.GetWriteRegion(RegionSize);
+        const int32 Count = static_cast<int32>(FMath::Min<int64>(RegionSize, Connection.SpillWriteOffset - Connection.SpillReadOffset));
+        if (!Connection.SpillFile->Seek(Connection.SpillReadOffset) || !Connection.SpillFile->Read(Region, Count))
+        {
+            UE_LOG(RConServer, Error, TEXT("Failed to read spilled responses of client %u, closing connection"), Connection.Id);
+            CloseConnection(Connection);
+            return;
+        }
+        SendBuffer.Commit(Count);
+        Connection.SpillReadOffset += Count;
+    }
 
-    UE_CLOG(bSendOk, RConServer, Verbose, TEXT("Send request: Type %d, Id %d, Body %s"), (int32)Packet.Type, Packet.Id, *Packet.Body);
-    UE_CLOG(!bSendOk, RConServer, Error, TEXT("Failed to send response, error code %i"), static_cast<int32>(GetSocketSubsystem()->GetLastErrorCode()));
+    // file is reused from its start by next spill
+    if (Connection.SpillFile && Connection.SpillReadOffset == Connection.SpillWriteOffset)
+    {
+        Connection.SpillReadOffset = 0;
+        Connection.SpillWriteOffset = 0;
+    }
 
-    return bSendOk;
+    if (Connection.bReadPaused && !HasSendOverflow(Connection))
+    {
+        UE_LOG(RConServer, Log, TEXT("Client %u caught up with responses, resuming reading from it"), Connection.Id);
+        Poller->Modify(Connection.Socket.Get(), Connection.Id, true, Connection.bWriteInterest);
+        Connection.bReadPaused = false;
+    }
 }
 
-void FRConServer::CloseConnection(FClientConnection& Connection)
+bool FRConServer::SpillToDisk(FClientConnection& Connection, const uint8* Data, int32 Size)
 {
-    if (Connection.Socket.IsValid())
+    if (Connection.SpillWriteOffset + Size > Settings.MaxSpillSize)
     {
-        Connection.Socket->Shutdown(ESocketShutdownMode::ReadWrite);
-        Connection.Socket->Close();
-        Connection.Socket.Reset();
+        UE_LOG(RConServer, Warning, TEXT("Client %u spilled responses exceed %lld bytes, closing connection"), Connection.Id, Settings.MaxSpillSize);
+        return false;
+    }
+
+    if (!Connection.SpillFile)
+    {
+        const FString SpillPath = GetSpillFilePath(Connection);
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        PlatformFile.CreateDirectoryTree(*FPaths::GetPath(SpillPath));
 
-        --ActiveConnections;
+        Connection.SpillFile.Reset(PlatformFile.OpenWrite(*SpillPath, false, true));
+        if (!Connection.SpillFile)
+        {
+            UE_LOG(RConServer, Error, TEXT("Failed to open spill file %s"), *SpillPath);
+            return false;
+        }
+        UE_LOG(RConServer, Log, TEXT("Client %u does not keep up with responses, spilling them to %s"), Connection.Id, *SpillPath);
     }
+
+    if (!Connection.SpillFile->Seek(Connection.SpillWriteOffset) || !Connection.SpillFile->Write(Data, Size))
+    {
+        UE_LOG(RConServer, Error, TEXT("Failed to write spilled responses of client %u"), Connection.Id);
+        return false;
+    }
+    Connection.SpillWriteOffset += Size;
+    return true;
 }
 
-void FRConServer::EnqueueResponse(FClientConnection& Connection, int32 RequestId, ERConPacketType Type, const FString& Payload)
+void FRConServer::CloseSpillFile(FClientConnection& Connection)
 {
-    // clang-format off
-    FRConPacket Packet
+    if (Connection.SpillFile)
     {
-        .Id = RequestId,
-        .Type = Type,
-        .Body = Payload
-    };
-    // clang-format on
-    Connection.SendQueue.Enqueue(MoveTemp(Packet));
+        Connection.SpillFile.Reset();
+        FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*GetSpillFilePath(Connection));
+    }
+    Connection.SpillReadOffset = 0;
+    Connection.SpillWriteOffset = 0;
+}
+
+FString FRConServer::GetSpillFilePath(const FClientConnection& Connection)
+{
+    // process id keeps forks sharing project directory apart
+    return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("RCon"), FString::Printf(TEXT("Spill_%u_%u.bin"), FPlatformProcess::GetCurrentProcessId(), Connection.Id));
+}
+
+bool FRConServer::HasSendOverflow(const FClientConnection& Connection)
+{
+    return Connection.SendOverflowOffset < Connection.SendOverflow.Num() || Connection.SpillReadOffset < Connection.SpillWriteOffset;
+}
+
+int32 FRConServer::GetSendBacklog(const FClientConnection& Connection)
+{
+    const int64 Backlog = Connection.SendBuffer.Num() + (Connection.SendOverflow.Num() - Connection.SendOverflowOffset) + (Connection.SpillWriteOffset - Connection.SpillReadOffset);
+    return static_cast<int32>(FMath::Min<int64>(Backlog, MAX_int32));
 }
\ No newline at end of file
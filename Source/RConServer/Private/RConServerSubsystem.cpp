@@ -3,31 +3,34 @@
 #include "RConServerSubsystem.h"
 
 #include <HAL/ConsoleManager.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Paths.h>
 
+#include "RConExecOutputDevice.h"
+#include "RConLogCapture.h"
 #include "RConServerSettings.h"
 
 DEFINE_LOG_CATEGORY_STATIC(RConServerSubsystem, Log, Log);
 #define STRINGIFY(Name) #Name
 
-class FExecOutputDevice : public FOutputDevice
-{
-public:
-    void Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category) override
-    {
-        if (!Output.IsEmpty())
-            Output.AppendChar(TEXT('\n'));
-        Output.Append(V);
-    }
-
-    FString Output{};
-};
-
 enum
 {
     COMMAND_EXEC = 1,
     COMMAND_RESPONSE = 2
 };
 
+void URConServerSubsystem::FCommandStats::Add(double Seconds)
+{
+    ++Count;
+    TotalTime += Seconds;
+    MaxTime = FMath::Max(MaxTime, Seconds);
+
+    int32 Bucket{0};
+    for (double Limit = 0.0001; Bucket < NumBuckets - 1 && Seconds >= Limit; Limit *= 10.0)
+        ++Bucket;
+    ++Buckets[Bucket];
+}
+
 URConServerSubsystem* URConServerSubsystem::Get(const UObject* Context)
 {
     UGameInstance* GameInstance{nullptr};
@@ -58,6 +61,13 @@ uint16 URConServerSubsystem::GetRConMaxActiveConnections()
     return !ClMaxActiveConnections.IsEmpty() ? FCString::Atoi(*ClMaxActiveConnections) : URConServerSettings::Get()->MaxActiveConnections;
 }
 
+int32 URConServerSubsystem::GetNumForks()
+{
+    int32 NumForks{0};
+    FParse::Value(FCommandLine::Get(), TEXT("-NumForks="), NumForks);
+    return FMath::Max(NumForks, 0);
+}
+
 bool URConServerSubsystem::ShouldCreateSubsystem_StaticCheck()
 {
     bool bAllowCreate = false;
@@ -88,16 +98,45 @@ void URConServerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
     IConsoleManager& ConsoleManager = IConsoleManager::Get();
     ConsoleManager.RegisterConsoleCommand(TEXT("rcon.server.start"), TEXT("Start rcon server"), FConsoleCommandWithArgsAndOutputDeviceDelegate::CreateUObject(this, &URConServerSubsystem::OnConsoleStartServer));
     ConsoleManager.RegisterConsoleCommand(TEXT("rcon.server.stop"), TEXT("Stop rcon server"), FConsoleCommandWithArgsAndOutputDeviceDelegate::CreateUObject(this, &URConServerSubsystem::OnConsoleStopServer));
+    ConsoleManager.RegisterConsoleCommand(TEXT("rcon.stats"), TEXT("Print rcon server counters and command latencies"), FConsoleCommandWithArgsAndOutputDeviceDelegate::CreateUObject(this, &URConServerSubsystem::OnConsoleStats));
 
     const FTickerDelegate TickDelegate = FTickerDelegate::CreateUObject(this, &URConServerSubsystem::TickServer);
     TickHandle = FTSTicker::GetCoreTicker().AddTicker(TickDelegate);
 
     FCommandProperties Properties{};
 
-    AddCommand(TEXT("help"), FRConServer::FHandleReceivedCommandDelegate::CreateUObject(this, &URConServerSubsystem::OnHelpCommand), TEXT("<command> - list all available command or print specific command help"), Properties);
+    // listing changes only with AddCommand, which drops all cached responses
+    Properties.CacheTTL = -1.0;
+    AddCommand(TEXT("help"), FRConServerCommandArgsCallback::CreateUObject(this, &URConServerSubsystem::OnHelpCommand), TEXT("<command> - list all available command or print specific command help"), Properties);
+    Properties.CacheTTL = 0.0;
 
     Properties.Help = TEXT("exec <command> \nRedirects input command to unreal GEngine->Exec function and responds with unreal output to that command");
-    AddCommand(TEXT("exec"), FRConServer::FHandleReceivedCommandDelegate::CreateUObject(this, &URConServerSubsystem::OnExecCommand), TEXT("<command> - execute unreal engine console command"), Properties);
+    AddCommand(TEXT("exec"), FRConServerCommandArgsCallback::CreateUObject(this, &URConServerSubsystem::OnExecCommand), TEXT("<command> - execute unreal engine console command"), Properties);
+
+    Properties.Help = TEXT("rcon.stats \nServer counters, rates since previous rcon.stats call and execution time histogram of each command. Same numbers feed 'stat rcon'");
+    AddCommand(TEXT("rcon.stats"), FRConServerCommandStructuredCallback::CreateUObject(this, &URConServerSubsystem::OnStatsCommand), TEXT("- rcon server counters and command latencies"), Properties);
+
+    Properties.Help = TEXT("format <text|json> \nChanges format of responses for this connection. Commands with structured responses and built-in ones respond with compact JSON object in json format");
+    AddCommand(TEXT("format"), FRConServerCommandArgsCallback::CreateUObject(this, &URConServerSubsystem::OnFormatCommand), TEXT("<text|json> - set response format for this connection"), Properties);
+
+    Properties.Help = TEXT("batch [-stoponerror] [-file=<script>] [command; command ...] \nRuns commands separated by ';' or new lines, or lines of script file in Saved/RCon/Scripts, and responds with combined output of all of them. Lines starting with '#' skipped. Long batches spread over several ticks");
+    Properties.bAllowInBatch = false;
+    AddCommand(TEXT("batch"), FRConServerCommandAsyncCallback::CreateUObject(this, &URConServerSubsystem::OnBatchCommand), TEXT("[-stoponerror] [-file=<script>] [command; command ...] - run several commands at once"), Properties);
+    Properties.bAllowInBatch = true;
+
+    Properties.Help = TEXT("subscribe [verbosity] [category ...] \nStreams log lines of given verbosity (Log by default) and categories (all by default) as responses to this request, until unsubscribed. Lines dropped for slow clients are summarized");
+    Properties.bAllowInBatch = false;
+    AddCommand(TEXT("subscribe"), FRConServerCommandArgsCallback::CreateUObject(this, &URConServerSubsystem::OnSubscribeCommand), TEXT("[verbosity] [category ...] - stream log lines"), Properties);
+    Properties.bAllowInBatch = true;
+
+    Properties.Help = TEXT("unsubscribe [subscription id] \nStops given log subscription, or all subscriptions of this connection");
+    AddCommand(TEXT("unsubscribe"), FRConServerCommandArgsCallback::CreateUObject(this, &URConServerSubsystem::OnUnsubscribeCommand), TEXT("[subscription id] - stop streaming log lines"), Properties);
+
+    Properties.Help = TEXT("fork <fork id> <command> \nRoutes command to given fork over loopback and responds with its response. Requires ForkRoutingPort set");
+    AddCommand(TEXT("fork"), FRConServerCommandAsyncCallback::CreateUObject(this, &URConServerSubsystem::OnForkCommand), TEXT("<fork id> <command> - run command on given fork"), Properties);
+
+    Properties.Help = TEXT("exec-all <command> \nRuns exec command on every fork in parallel and responds with collected output of each one. Requires ForkRoutingPort set");
+    AddCommand(TEXT("exec-all"), FRConServerCommandAsyncCallback::CreateUObject(this, &URConServerSubsystem::OnExecAllCommand), TEXT("<command> - execute unreal engine console command on every fork"), Properties);
 
     FCoreDelegates::OnPostFork.AddUObject(this, &URConServerSubsystem::OnPostFork);
 
@@ -109,6 +148,12 @@ void URConServerSubsystem::Deinitialize()
     Super::Deinitialize();
 
     FCoreDelegates::OnPostFork.RemoveAll(this);
+    if (bLogCaptureRegistered)
+    {
+        GLog->RemoveOutputDevice(LogCapture.Get());
+        bLogCaptureRegistered = false;
+    }
+
     if (TickHandle.IsValid())
     {
         FTSTicker::GetCoreTicker().RemoveTicker(TickHandle);
@@ -129,18 +174,45 @@ void URConServerSubsystem::StartServer()
         return;
     }
 
+    const int32 ForkId = FForkProcessHelper::GetForkedChildProcessIndex();
+    const bool bShareForkPort = URConServerSettings::Get()->bShareForkPort;
+    const int32 ForkRoutingPort = URConServerSettings::Get()->ForkRoutingPort;
+
     FRConServer::FSettings Settings{};
-    Settings.Port = GetRConPort() + FForkProcessHelper::GetForkedChildProcessIndex();
+    Settings.Port = bShareForkPort ? GetRConPort() : GetRConPort() + ForkId;
     Settings.Password = GetRConPassword();
-    Settings.bAllowPortReuse = FForkProcessHelper::IsForkedChildProcess();
+    for (const FRConCredential& Credential : URConServerSettings::Get()->Credentials)
+        Settings.Credentials.Add(FRConServer::FCredential{Credential.Name, Credential.Password});
+    // parent listens with reuse too, children could bind before it closes its socket
+    Settings.bAllowPortReuse = FForkProcessHelper::IsForkedChildProcess() || bShareForkPort;
+    if (FForkProcessHelper::IsForkedChildProcess() && ForkRoutingPort > 0)
+        Settings.LoopbackPort = static_cast<uint16>(ForkRoutingPort + ForkId);
     Settings.MaxActiveConnections = GetRConMaxActiveConnections();
+    Settings.ListenBacklog = URConServerSettings::Get()->ListenBacklog;
+    Settings.bUseNetworkThread = URConServerSettings::Get()->bUseNetworkThread;
+    Settings.DelayedResponseTimeout = URConServerSettings::Get()->DelayedResponseTimeout;
+    Settings.MaxCommandsPerTick = URConServerSettings::Get()->MaxCommandsPerTick;
+    Settings.CommandTimeBudgetMs = URConServerSettings::Get()->CommandTimeBudgetMs;
+    Settings.CommandRateLimit = URConServerSettings::Get()->CommandRateLimit;
+    Settings.CommandRateBurst = URConServerSettings::Get()->CommandRateBurst;
+    Settings.MaxSendBufferSize = URConServerSettings::Get()->MaxSendBufferSize;
+    Settings.SendOverflowPolicy = static_cast<FRConServer::ESendOverflowPolicy>(URConServerSettings::Get()->SendOverflowPolicy);
+    Settings.MaxSpillSize = URConServerSettings::Get()->MaxSpillSize;
+    Settings.MaxUnauthenticatedConnections = URConServerSettings::Get()->MaxUnauthenticatedConnections;
+    Settings.AuthTimeout = URConServerSettings::Get()->AuthTimeout;
+    Settings.MaxAuthFailures = URConServerSettings::Get()->MaxAuthFailures;
+    Settings.AuthFailureDecayTime = URConServerSettings::Get()->AuthFailureDecayTime;
+    Settings.AuthBanTime = URConServerSettings::Get()->AuthBanTime;
 
     if (RConServer.Start(Settings))
     {
+        RebuildPermissions();
+
         UE_LOG(RConServerSubsystem, Log, TEXT("RCon server started. Using port: %d"), RConServer.GetBoundPort());
 
         RConServer.AssignClientConnectedCallback(FRConServer::FHandleClientConnectedDelegate::CreateUObject(this, &URConServerSubsystem::HandleClientConnected));
         RConServer.AssignCommandCallback(FRConServer::FHandleReceivedCommandDelegate::CreateUObject(this, &URConServerSubsystem::HandleRConCommand));
+        RConServer.AssignRequestCanceledCallback(FRConServer::FHandleRequestCanceledDelegate::CreateUObject(this, &URConServerSubsystem::HandleRequestCanceled));
     }
     else
     {
@@ -160,6 +232,19 @@ void URConServerSubsystem::StopServer()
         RConServer.Stop();
         UE_LOG(RConServerSubsystem, Log, TEXT("RCon server stopped"));
     }
+
+    for (auto& [RequestId, AsyncRequest] : AsyncRequests)
+        AsyncRequest.CancellationToken->Cancel();
+    AsyncRequests.Reset();
+
+    // canceled above with their async requests, let them clean up
+    RunBatches();
+
+    LogSubscriptions.Reset();
+    UpdateLogCapture();
+
+    ForkClient.Reset();
+    ForkConnections.Reset();
 }
 
 void URConServerSubsystem::AddCommand(FString InCommand, FRConServerCommandCallback InCallback, FString InTooltip, FCommandProperties InProperties)
@@ -173,10 +258,52 @@ void URConServerSubsystem::AddCommand(FString InCommand, FRConServerCommandCallb
     AddCommand(MoveTemp(CommandHandle));
 }
 
+void URConServerSubsystem::AddCommand(FString InCommand, FRConServerCommandArgsCallback InCallback, FString InTooltip, FCommandProperties InProperties)
+{
+    FCommandHandle CommandHandle{};
+    CommandHandle.Command = MoveTemp(InCommand);
+    CommandHandle.ArgsCallback = MoveTemp(InCallback);
+    CommandHandle.Tooltip = MoveTemp(InTooltip);
+    CommandHandle.Properties = MoveTemp(InProperties);
+
+    AddCommand(MoveTemp(CommandHandle));
+}
+
+void URConServerSubsystem::AddCommand(FString InCommand, FRConServerCommandStructuredCallback InCallback, FString InTooltip, FCommandProperties InProperties)
+{
+    FCommandHandle CommandHandle{};
+    CommandHandle.Command = MoveTemp(InCommand);
+    CommandHandle.StructuredCallback = MoveTemp(InCallback);
+    CommandHandle.Tooltip = MoveTemp(InTooltip);
+    CommandHandle.Properties = MoveTemp(InProperties);
+
+    AddCommand(MoveTemp(CommandHandle));
+}
+
+void URConServerSubsystem::AddCommand(FString InCommand, FRConServerCommandAsyncCallback InCallback, FString InTooltip, FCommandProperties InProperties)
+{
+    FCommandHandle CommandHandle{};
+    CommandHandle.Command = MoveTemp(InCommand);
+    CommandHandle.AsyncCallback = MoveTemp(InCallback);
+    CommandHandle.Tooltip = MoveTemp(InTooltip);
+    CommandHandle.Properties = MoveTemp(InProperties);
+
+    AddCommand(MoveTemp(CommandHandle));
+}
+
 void URConServerSubsystem::AddCommand(FCommandHandle InCommandHandle)
 {
     UE_LOG(RConServerSubsystem, Verbose, TEXT("Registered command: %s"), *InCommandHandle.Command);
+    // replaced command keeps its permission bit
+    const FCommandHandle* ExistingHandle = CommandHandles.Find(InCommandHandle.Command);
+    InCommandHandle.Index = ExistingHandle ? ExistingHandle->Index : CommandHandles.Num();
     CommandHandles.Emplace(InCommandHandle.Command, InCommandHandle);
+
+    // map could reallocate, invalidating handle pointers held by trie
+    RebuildCommandTrie();
+    RebuildPermissions();
+    // replaced handler or 'help' listing out of date
+    InvalidateAllCachedResponses();
 }
 
 void URConServerSubsystem::TryAutoStart()
@@ -199,6 +326,19 @@ bool URConServerSubsystem::TickServer(float DeltaTime)
     if (RConServer.IsStarted())
     {
         RConServer.Tick();
+        // before async requests, finished batch responds in the same tick
+        if (Batches.Num())
+            RunBatches();
+        CompleteAsyncRequests();
+        if (LogSubscriptions.Num())
+            SendLogLines();
+
+        // routing is rare, don't keep thread and connections to every fork around
+        if (ForkClient && AsyncRequests.IsEmpty())
+        {
+            ForkClient.Reset();
+            ForkConnections.Reset();
+        }
     }
     return true;
 }
@@ -209,21 +349,152 @@ void URConServerSubsystem::HandleClientConnected()
 
 void URConServerSubsystem::HandleRConCommand(int32 RequestId, const FString& Command, FString& Response, bool& bDelayResponse)
 {
-    auto* CommandHandle = FindCommandHandle(Command);
-    if (CommandHandle)
+    TOptional<FAsyncRequest> AsyncRequest{};
+    RunCommand(RequestId, Command, false, Response, bDelayResponse, AsyncRequest);
+
+    if (AsyncRequest.IsSet())
+    {
+        // response sent from tick, once future completes
+        bDelayResponse = true;
+        AsyncRequests.Emplace(RequestId, MoveTemp(AsyncRequest.GetValue()));
+    }
+}
+
+bool URConServerSubsystem::RunCommand(int32 RequestId, const FString& Command, bool bInBatch, FString& Response, bool& bDelayResponse, TOptional<FAsyncRequest>& OutAsyncRequest)
+{
+    FStringView Args{};
+    auto* CommandHandle = FindCommandHandle(Command, Args);
+    if (!CommandHandle)
     {
-        if (CommandHandle->Callback.IsBound())
+        Response = FString::Printf(TEXT("Command \'%s\' not recognized (use \'help\' to list all available commands)"), *Command);
+        return false;
+    }
+
+    const int32 Principal = RConServer.GetRequestPrincipal(RequestId);
+    if (!(PrincipalPermissions.IsValidIndex(Principal) && PrincipalPermissions[Principal][CommandHandle->Index]))
+    {
+        Response = FString::Printf(TEXT("Command \'%s\' is not allowed"), *CommandHandle->Command);
+        return false;
+    }
+
+    if (bInBatch && !CommandHandle->Properties.bAllowInBatch)
+    {
+        Response = FString::Printf(TEXT("Command \'%s\' could not be part of batch"), *CommandHandle->Command);
+        return false;
+    }
+
+    const double StartTime = FPlatformTime::Seconds();
+    TGuardValue<bool> RunningBatchCommandGuard{bRunningBatchCommand, bInBatch};
+    bCommandFailed = false;
+
+    const bool bCacheable = CommandHandle->Properties.CacheTTL != 0.0 && !CommandHandle->AsyncCallback.IsBound();
+    const ERConResponseFormat Format = RConServer.GetResponseFormat(RequestId);
+    if (bCacheable)
+    {
+        const FCachedResponse* CachedResponse = CachedResponses.Find(Command);
+        if (CachedResponse && CachedResponse->Format == Format && CachedResponse->ExpireTime > StartTime)
         {
-            CommandHandle->Callback.Execute(RequestId, Command, Response, bDelayResponse);
+            Response = CachedResponse->Response;
+            CommandHandle->Stats.Add(FPlatformTime::Seconds() - StartTime);
+            return true;
         }
-        else
+    }
+
+    if (CommandHandle->AsyncCallback.IsBound())
+    {
+        TSharedRef<FRConCancellationToken> CancellationToken = MakeShared<FRConCancellationToken>();
+        TFuture<FString> Future = CommandHandle->AsyncCallback.Execute(RequestId, Args, CancellationToken);
+        if (!Future.IsValid())
         {
-            Response = FString::Printf(TEXT("Recognized command \'%s\', but has no bound callback. Huh."), *CommandHandle->Command);
+            Response = FString::Printf(TEXT("Command \'%s\' failed to start"), *CommandHandle->Command);
+            return false;
         }
+
+        // counted once completed
+        OutAsyncRequest.Emplace(FAsyncRequest{MoveTemp(Future), MoveTemp(CancellationToken), CommandHandle->Command, StartTime});
+        return true;
+    }
+    else if (CommandHandle->StructuredCallback.IsBound())
+    {
+        ResponseWriter.Reset(RConServer.GetResponseFormat(RequestId));
+        CommandHandle->StructuredCallback.Execute(RequestId, Args, ResponseWriter);
+        Response = ResponseWriter.Finish();
+    }
+    else if (CommandHandle->ArgsCallback.IsBound())
+    {
+        CommandHandle->ArgsCallback.Execute(RequestId, Args, Response, bDelayResponse);
+    }
+    else if (CommandHandle->Callback.IsBound())
+    {
+        CommandHandle->Callback.Execute(RequestId, Command, Response, bDelayResponse);
     }
     else
     {
-        Response = FString::Printf(TEXT("Command \'%s\' not recognized (use \'help\' to list all available commands)"), *Command);
+        Response = FString::Printf(TEXT("Recognized command \'%s\', but has no bound callback. Huh."), *CommandHandle->Command);
+        return false;
+    }
+
+    // delayed ones counted only for synchronous part
+    CommandHandle->Stats.Add(FPlatformTime::Seconds() - StartTime);
+
+    // failed response is not cached, next run could succeed
+    if (bCommandFailed)
+        return false;
+
+    if (bCacheable && !bDelayResponse)
+    {
+        // polled command lines are cached again by their next poll
+        if (CachedResponses.Num() >= MaxCachedResponses)
+            CachedResponses.Reset();
+
+        const double ExpireTime = CommandHandle->Properties.CacheTTL > 0.0 ? StartTime + CommandHandle->Properties.CacheTTL : MAX_dbl;
+        CachedResponses.Add(Command, FCachedResponse{Response, CommandHandle->Command, Format, ExpireTime});
+    }
+    return true;
+}
+
+void URConServerSubsystem::InvalidateCachedResponses(const FString& Command)
+{
+    for (auto It = CachedResponses.CreateIterator(); It; ++It)
+    {
+        if (It.Value().Command.Equals(Command, ESearchCase::IgnoreCase))
+            It.RemoveCurrent();
+    }
+}
+
+void URConServerSubsystem::InvalidateAllCachedResponses()
+{
+    CachedResponses.Reset();
+}
+
+void URConServerSubsystem::HandleRequestCanceled(int32 RequestId)
+{
+    if (LogSubscriptions.RemoveAll([RequestId](const FLogSubscription& Subscription) { return Subscription.RequestId == RequestId; }))
+    {
+        UE_LOG(RConServerSubsystem, Verbose, TEXT("Log subscription %d canceled"), RequestId);
+        UpdateLogCapture();
+    }
+
+    if (FAsyncRequest* AsyncRequest = AsyncRequests.Find(RequestId))
+    {
+        UE_LOG(RConServerSubsystem, Verbose, TEXT("Async request %d canceled"), RequestId);
+        AsyncRequest->CancellationToken->Cancel();
+        AsyncRequests.Remove(RequestId);
+    }
+}
+
+void URConServerSubsystem::CompleteAsyncRequests()
+{
+    for (auto It = AsyncRequests.CreateIterator(); It; ++It)
+    {
+        if (It.Value().Future.IsReady())
+        {
+            if (FCommandHandle* CommandHandle = CommandHandles.Find(It.Value().Command))
+                CommandHandle->Stats.Add(FPlatformTime::Seconds() - It.Value().StartTime);
+
+            RConServer.SendResponse(It.Key(), It.Value().Future.Consume());
+            It.RemoveCurrent();
+        }
     }
 }
 
@@ -242,46 +513,226 @@ void URConServerSubsystem::OnConsoleStopServer(const TArray<FString>& Args, FOut
     OutputDevice.Serialize(TEXT("RCon server stopped"), ELogVerbosity::Display, STRINGIFY(RConServerSubsystem));
 }
 
-URConServerSubsystem::FCommandHandle* URConServerSubsystem::FindCommandHandle(const FString& Command)
+void URConServerSubsystem::OnConsoleStats(const TArray<FString>& Args, FOutputDevice& OutputDevice)
+{
+    FRConResponseWriter Writer{};
+    WriteStats(Writer);
+    OutputDevice.Serialize(*Writer.Finish(), ELogVerbosity::Display, STRINGIFY(RConServerSubsystem));
+}
+
+void URConServerSubsystem::OnStatsCommand(int32 RequestId, FStringView Args, FRConResponseWriter& Writer)
+{
+    WriteStats(Writer);
+}
+
+void URConServerSubsystem::WriteStats(FRConResponseWriter& Writer)
+{
+    const FRConServer::FStats Stats = RConServer.GetStats();
+    const double Now = FPlatformTime::Seconds();
+    const double Elapsed = LastStatsTime > 0.0 ? Now - LastStatsTime : 0.0;
+
+    Writer.WriteBool(TEXT("started"), RConServer.IsStarted());
+    Writer.WriteInt(TEXT("activeConnections"), Stats.ActiveConnections);
+    Writer.WriteInt(TEXT("queuedCommands"), Stats.QueuedCommands);
+    Writer.WriteInt(TEXT("pendingRequests"), Stats.PendingRequests);
+    Writer.WriteInt(TEXT("asyncRequests"), AsyncRequests.Num());
+    Writer.WriteInt(TEXT("logSubscriptions"), LogSubscriptions.Num());
+    Writer.WriteInt(TEXT("sendBacklog"), Stats.SendBacklog);
+    Writer.WriteInt(TEXT("bytesReceived"), Stats.BytesReceived);
+    Writer.WriteInt(TEXT("bytesSent"), Stats.BytesSent);
+    Writer.WriteInt(TEXT("packetsReceived"), Stats.PacketsReceived);
+    Writer.WriteInt(TEXT("packetsSent"), Stats.PacketsSent);
+    Writer.WriteInt(TEXT("commandsDispatched"), Stats.CommandsDispatched);
+    Writer.WriteInt(TEXT("commandsRateLimited"), Stats.CommandsRateLimited);
+    Writer.WriteInt(TEXT("requestsTimedOut"), Stats.RequestsTimedOut);
+    Writer.WriteInt(TEXT("connectionsAccepted"), Stats.ConnectionsAccepted);
+    Writer.WriteInt(TEXT("connectionsRefused"), Stats.ConnectionsRefused);
+    Writer.WriteInt(TEXT("connectionsRejected"), Stats.ConnectionsRejected);
+    Writer.WriteInt(TEXT("authFailures"), Stats.AuthFailures);
+
+    // first call has nothing to compare against
+    if (Elapsed > 0.0)
+    {
+        Writer.WriteDouble(TEXT("intervalSeconds"), Elapsed);
+        Writer.WriteDouble(TEXT("bytesReceivedPerSecond"), (Stats.BytesReceived - LastStats.BytesReceived) / Elapsed);
+        Writer.WriteDouble(TEXT("bytesSentPerSecond"), (Stats.BytesSent - LastStats.BytesSent) / Elapsed);
+        Writer.WriteDouble(TEXT("packetsReceivedPerSecond"), (Stats.PacketsReceived - LastStats.PacketsReceived) / Elapsed);
+        Writer.WriteDouble(TEXT("packetsSentPerSecond"), (Stats.PacketsSent - LastStats.PacketsSent) / Elapsed);
+        Writer.WriteDouble(TEXT("commandsPerSecond"), (Stats.CommandsDispatched - LastStats.CommandsDispatched) / Elapsed);
+    }
+    LastStats = Stats;
+    LastStatsTime = Now;
+
+    static const TCHAR* BucketNames[FCommandStats::NumBuckets] = {TEXT("under100us"), TEXT("under1ms"), TEXT("under10ms"), TEXT("under100ms"), TEXT("under1s"), TEXT("over1s")};
+
+    Writer.BeginArray(TEXT("commands"));
+    for (const auto& [CommandKey, CommandHandle] : CommandHandles)
+    {
+        const FCommandStats& CommandStats = CommandHandle.Stats;
+        if (CommandStats.Count == 0)
+            continue;
+
+        Writer.BeginObject();
+        Writer.WriteString(TEXT("command"), CommandHandle.Command);
+        Writer.WriteInt(TEXT("count"), CommandStats.Count);
+        Writer.WriteDouble(TEXT("averageMs"), CommandStats.TotalTime * 1000.0 / CommandStats.Count);
+        Writer.WriteDouble(TEXT("maxMs"), CommandStats.MaxTime * 1000.0);
+        for (int32 i = 0; i < FCommandStats::NumBuckets; ++i)
+            Writer.WriteInt(BucketNames[i], CommandStats.Buckets[i]);
+        Writer.EndObject();
+    }
+    Writer.EndArray();
+}
+
+URConServerSubsystem::FCommandHandle* URConServerSubsystem::FindCommandHandle(FStringView Command)
 {
-    // Chop parts of a original command, until found match
-    FString InputCommand = Command;
+    FStringView Args{};
+    return FindCommandHandle(Command, Args);
+}
+
+URConServerSubsystem::FCommandHandle* URConServerSubsystem::FindCommandHandle(FStringView Command, FStringView& OutArgs)
+{
+    if (CommandTrie.IsEmpty())
+        return nullptr;
 
-    for (uint8 i = 0; i < /* MaxDepth */ UINT8_MAX; ++i)
+    // walk input word by word, remembering deepest node with registered command
+    FCommandHandle* Found{};
+    int32 NodeIndex{0};
+    int32 TokenStart{0};
+    for (;;)
     {
-        auto* Handle = CommandHandles.Find(InputCommand);
-        if (Handle)
+        int32 TokenEnd = TokenStart;
+        while (TokenEnd < Command.Len() && Command[TokenEnd] != TEXT(' '))
+            ++TokenEnd;
+
+        NodeIndex = FindCommandTrieChild(NodeIndex, Command.Mid(TokenStart, TokenEnd - TokenStart));
+        if (NodeIndex == INDEX_NONE)
+            break;
+
+        if (CommandTrie[NodeIndex].Handle)
         {
-            return Handle;
+            Found = CommandTrie[NodeIndex].Handle;
+            OutArgs = Command.RightChop(FMath::Min(TokenEnd + 1, Command.Len()));
         }
-        else
+
+        if (TokenEnd >= Command.Len())
+            break;
+        TokenStart = TokenEnd + 1;
+    }
+    return Found;
+}
+
+void URConServerSubsystem::RebuildPermissions()
+{
+    const TArray<FRConCredential>& Credentials = URConServerSettings::Get()->Credentials;
+    const int32 NumCommands = CommandHandles.Num();
+
+    PrincipalPermissions.SetNum(1 + Credentials.Num());
+    // main password allowed everything
+    PrincipalPermissions[0].Init(true, NumCommands);
+
+    for (int32 i = 0; i < Credentials.Num(); ++i)
+    {
+        TBitArray<>& Permissions = PrincipalPermissions[i + 1];
+        Permissions.Init(false, NumCommands);
+
+        for (const FString& AllowedCommand : Credentials[i].AllowedCommands)
         {
-            int32 SpaceIndex{0};
-            if (InputCommand.FindLastChar(TEXT(' '), SpaceIndex))
+            if (AllowedCommand == TEXT("*"))
             {
-                InputCommand = InputCommand.Left(SpaceIndex);
+                Permissions.Init(true, NumCommands);
+                break;
             }
-            else
+
+            // commands registered later picked up by next rebuild
+            if (const FCommandHandle* Handle = CommandHandles.Find(AllowedCommand))
+                Permissions[Handle->Index] = true;
+        }
+    }
+}
+
+void URConServerSubsystem::RebuildCommandTrie()
+{
+    CommandTrie.Reset();
+    CommandTrie.AddDefaulted();
+
+    for (auto& [CommandKey, CommandHandle] : CommandHandles)
+    {
+        int32 NodeIndex{0};
+        FStringView Remaining = CommandHandle.Command;
+        for (;;)
+        {
+            int32 SpaceIndex{};
+            const bool bLastToken = !Remaining.FindChar(TEXT(' '), SpaceIndex);
+            const FStringView Token = bLastToken ? Remaining : Remaining.Left(SpaceIndex);
+
+            int32 ChildIndex = FindCommandTrieChild(NodeIndex, Token);
+            if (ChildIndex == INDEX_NONE)
             {
-                break;
+                ChildIndex = CommandTrie.AddDefaulted();
+                CommandTrie[ChildIndex].Token = FString(Token);
+                CommandTrie[NodeIndex].Children.Add(ChildIndex);
             }
+            NodeIndex = ChildIndex;
+
+            if (bLastToken)
+                break;
+            Remaining.RightChopInline(SpaceIndex + 1);
         }
+        CommandTrie[NodeIndex].Handle = &CommandHandle;
     }
-    return nullptr;
 }
 
-void URConServerSubsystem::OnHelpCommand(int32 RequestId, const FString& Command, FString& Response, bool& bDelayResponse)
+int32 URConServerSubsystem::FindCommandTrieChild(int32 NodeIndex, FStringView Token) const
 {
-    FString CommandArg{};
-    int32 SpaceIndex;
-    if (Command.FindChar(TEXT(' '), SpaceIndex) && Command.IsValidIndex(SpaceIndex + 1))
+    // case insensitive, same as FString keys of CommandHandles
+    for (const int32 ChildIndex : CommandTrie[NodeIndex].Children)
     {
-        CommandArg = Command.Mid(SpaceIndex + 1);
+        if (Token.Equals(CommandTrie[ChildIndex].Token, ESearchCase::IgnoreCase))
+            return ChildIndex;
+    }
+    return INDEX_NONE;
+}
+
+void URConServerSubsystem::OnHelpCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse)
+{
+    if (RConServer.GetResponseFormat(RequestId) != ERConResponseFormat::Text)
+    {
+        ResponseWriter.Reset(RConServer.GetResponseFormat(RequestId));
+        auto* CommandHandle = Args.Len() ? FindCommandHandle(Args) : nullptr;
+        if (CommandHandle)
+        {
+            ResponseWriter.WriteString(TEXT("command"), CommandHandle->Command);
+            ResponseWriter.WriteString(TEXT("tooltip"), CommandHandle->Tooltip);
+            ResponseWriter.WriteString(TEXT("help"), CommandHandle->Properties.Help);
+            ResponseWriter.WriteBool(TEXT("bound"), CommandHandle->IsBound());
+        }
+        else if (Args.Len())
+        {
+            ResponseWriter.WriteString(TEXT("error"), TEXT("Command not recognized"));
+        }
+        else
+        {
+            ResponseWriter.WriteInt(TEXT("processId"), FPlatformProcess::GetCurrentProcessId());
+            ResponseWriter.WriteInt(TEXT("forkId"), FForkProcessHelper::GetForkedChildProcessIndex());
+            ResponseWriter.BeginArray(TEXT("commands"));
+            for (const auto& [CommandKey, CommandHandle] : CommandHandles)
+            {
+                ResponseWriter.BeginObject();
+                ResponseWriter.WriteString(TEXT("command"), CommandHandle.Command);
+                ResponseWriter.WriteString(TEXT("tooltip"), CommandHandle.Tooltip);
+                ResponseWriter.WriteBool(TEXT("bound"), CommandHandle.IsBound());
+                ResponseWriter.EndObject();
+            }
+            ResponseWriter.EndArray();
+        }
+        Response = ResponseWriter.Finish();
+        return;
     }
 
-    if (CommandArg.Len())
+    if (Args.Len())
     {
-        auto* CommandHandle = FindCommandHandle(CommandArg);
+        auto* CommandHandle = FindCommandHandle(Args);
         if (CommandHandle)
         {
             Response.Append(FString::Printf(TEXT("%s %s \n - - - \n"), *CommandHandle->Command, *CommandHandle->Tooltip));
@@ -296,7 +747,7 @@ void URConServerSubsystem::OnHelpCommand(int32 RequestId, const FString& Command
         }
         else
         {
-            Response.Append(FString::Printf(TEXT("Help. Command \"%s\" not recognized!"), *CommandArg));
+            Response.Append(FString::Printf(TEXT("Help. Command \"%.*s\" not recognized!"), Args.Len(), Args.GetData()));
         }
     }
     else
@@ -308,7 +759,7 @@ void URConServerSubsystem::OnHelpCommand(int32 RequestId, const FString& Command
         Response.Append(TEXT("Listing all available commands:\n"));
         for (const auto& [CommandKey, CommandHandle] : CommandHandles)
         {
-            if (CommandHandle.Callback.IsBound())
+            if (CommandHandle.IsBound())
             {
                 Response.Append(FString::Printf(TEXT("%s %s \n"), *CommandHandle.Command, *CommandHandle.Tooltip));
             }
@@ -320,26 +771,490 @@ void URConServerSubsystem::OnHelpCommand(int32 RequestId, const FString& Command
     }
 }
 
-void URConServerSubsystem::OnExecCommand(int32 RequestId, const FString& Command, FString& Response, bool& bDelayResponse)
+void URConServerSubsystem::OnExecCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse)
+{
+    // Exec needs null terminated string
+    const FString CommandArg{Args};
+
+    const bool bJson = RConServer.GetResponseFormat(RequestId) == ERConResponseFormat::Json;
+    // partial responses of batch request would land in front of its combined response
+    FRConExecOutputDevice OutputDevice{bRunningBatchCommand ? nullptr : &RConServer, RequestId, URConServerSettings::Get()->MaxExecOutputSize, bJson};
+    if (bJson)
+    {
+        // output streamed as escaped string value, chunks joined by client form a single object
+        FString Prefix{TEXT("{\"command\":\"")};
+        FRConResponseWriter::AppendJsonEscaped(Prefix, CommandArg);
+        Prefix.Append(TEXT("\",\"output\":\""));
+        OutputDevice.Write(Prefix);
+
+        const bool bExec = GEngine->Exec(GetWorld(), *CommandArg, OutputDevice);
+        OutputDevice.Write(bExec ? TEXT("\",\"success\":true}") : TEXT("\",\"success\":false}"));
+        bCommandFailed = !bExec;
+    }
+    else
+    {
+        // header repeats whole command line, as it always did
+        OutputDevice.Write(TEXT("exec: exec "));
+        OutputDevice.Write(CommandArg);
+        OutputDevice.Write(TEXT("; \n "));
+
+        const bool bExec = GEngine->Exec(GetWorld(), *CommandArg, OutputDevice);
+        if (!bExec)
+            OutputDevice.Write(TEXT("Failed to execute"));
+        bCommandFailed = !bExec;
+    }
+
+    Response = OutputDevice.Finish();
+}
+
+void URConServerSubsystem::OnFormatCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse)
+{
+    if (Args.Equals(TEXT("json"), ESearchCase::IgnoreCase))
+        RConServer.SetResponseFormat(RequestId, ERConResponseFormat::Json);
+    else if (Args.Equals(TEXT("text"), ESearchCase::IgnoreCase))
+        RConServer.SetResponseFormat(RequestId, ERConResponseFormat::Text);
+    else if (Args.Len())
+    {
+        Response = FString::Printf(TEXT("Unknown format \'%.*s\', expected text or json"), Args.Len(), Args.GetData());
+        return;
+    }
+
+    // already answered in new format
+    const ERConResponseFormat Format = RConServer.GetResponseFormat(RequestId);
+    ResponseWriter.Reset(Format);
+    ResponseWriter.WriteString(TEXT("format"), Format == ERConResponseFormat::Json ? TEXT("json") : TEXT("text"));
+    Response = ResponseWriter.Finish();
+}
+
+void URConServerSubsystem::OnSubscribeCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse)
+{
+    FLogSubscription Subscription{};
+    Subscription.RequestId = RequestId;
+    Subscription.Verbosity = ELogVerbosity::Log;
+
+    TArray<FString> Tokens{};
+    FString(Args).ParseIntoArray(Tokens, TEXT(" "));
+    for (int32 i = 0; i < Tokens.Num(); ++i)
+    {
+        // optional verbosity goes first, rest are categories
+        const ELogVerbosity::Type Verbosity = i == 0 ? ParseLogVerbosityFromString(Tokens[i]) : ELogVerbosity::NoLogging;
+        if (Verbosity != ELogVerbosity::NoLogging)
+            Subscription.Verbosity = Verbosity;
+        else
+            Subscription.Categories.Add(FName(*Tokens[i]));
+    }
+
+    // request stays open, lines sent as its partial responses
+    bDelayResponse = true;
+    RConServer.KeepRequestOpen(RequestId);
+    RConServer.SendPartialResponse(RequestId, FString::Printf(TEXT("Subscribed to log, use \'unsubscribe %d\' to stop"), RequestId));
+
+    LogSubscriptions.Add(MoveTemp(Subscription));
+    UpdateLogCapture();
+}
+
+void URConServerSubsystem::OnUnsubscribeCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse)
+{
+    int32 SubscriptionId{INDEX_NONE};
+    if (Args.Len() && !LexTryParseString(SubscriptionId, *FString(Args)))
+    {
+        Response = FString::Printf(TEXT("Expected subscription id, got \'%.*s\'"), Args.Len(), Args.GetData());
+        return;
+    }
+
+    const uint32 ConnectionId = RConServer.GetRequestConnectionId(RequestId);
+    int32 NumRemoved{};
+    for (int32 i = LogSubscriptions.Num() - 1; i > -1; --i)
+    {
+        // only own subscriptions, request ids of other connections are easy to guess
+        FLogSubscription& Subscription = LogSubscriptions[i];
+        if (RConServer.GetRequestConnectionId(Subscription.RequestId) != ConnectionId)
+            continue;
+        if (SubscriptionId != INDEX_NONE && Subscription.RequestId != SubscriptionId)
+            continue;
+
+        // final response closes the request
+        RConServer.SendPartialResponse(Subscription.RequestId, MoveTemp(Subscription.Batch));
+        RConServer.SendResponse(Subscription.RequestId, TEXT("Unsubscribed from log"));
+        LogSubscriptions.RemoveAt(i, EAllowShrinking::No);
+        ++NumRemoved;
+    }
+    UpdateLogCapture();
+
+    Response = FString::Printf(TEXT("Removed %d log subscriptions"), NumRemoved);
+}
+
+void URConServerSubsystem::UpdateLogCapture()
+{
+    if (LogSubscriptions.IsEmpty())
+    {
+        if (bLogCaptureRegistered)
+        {
+            GLog->RemoveOutputDevice(LogCapture.Get());
+            bLogCaptureRegistered = false;
+
+            // leftovers would go to next subscriber otherwise
+            FRConLogCapture::FLine Line{};
+            while (LogCapture->Dequeue(Line))
+            {
+            }
+            LogCapture->ConsumeDroppedLines();
+        }
+        return;
+    }
+
+    if (!LogCapture)
+        LogCapture = MakeShared<FRConLogCapture>(URConServerSettings::Get()->MaxLogQueueLines);
+
+    ELogVerbosity::Type MaxVerbosity{ELogVerbosity::NoLogging};
+    for (const FLogSubscription& Subscription : LogSubscriptions)
+        MaxVerbosity = FMath::Max(MaxVerbosity, Subscription.Verbosity);
+    LogCapture->SetMaxVerbosity(MaxVerbosity);
+
+    if (!bLogCaptureRegistered)
+    {
+        GLog->AddOutputDevice(LogCapture.Get());
+        bLogCaptureRegistered = true;
+    }
+}
+
+void URConServerSubsystem::SendLogLines()
 {
-    FString CommandArg{};
-    int32 SpaceIndex;
-    if (Command.FindChar(TEXT(' '), SpaceIndex) && Command.IsValidIndex(SpaceIndex + 1))
+    const int32 MaxBacklog = URConServerSettings::Get()->MaxLogBacklog;
+    for (FLogSubscription& Subscription : LogSubscriptions)
+        Subscription.bCongested = RConServer.GetRequestSendBacklog(Subscription.RequestId) > MaxBacklog;
+
+    FRConLogCapture::FLine Line{};
+    while (LogCapture->Dequeue(Line))
+    {
+        for (FLogSubscription& Subscription : LogSubscriptions)
+        {
+            if (Line.Verbosity > Subscription.Verbosity || (Subscription.Categories.Num() && !Subscription.Categories.Contains(Line.Category)))
+                continue;
+
+            // slow client only gets summary once it catches up
+            if (Subscription.bCongested || Subscription.Batch.Len() >= MaxBacklog)
+            {
+                ++Subscription.DroppedLines;
+                continue;
+            }
+
+            if (!Subscription.Batch.IsEmpty())
+                Subscription.Batch.AppendChar(TEXT('\n'));
+            Line.Category.AppendString(Subscription.Batch);
+            Subscription.Batch.Append(TEXT(": "));
+            if (Line.Verbosity != ELogVerbosity::Log)
+            {
+                Subscription.Batch.Append(ToString(Line.Verbosity));
+                Subscription.Batch.Append(TEXT(": "));
+            }
+            Subscription.Batch.Append(Line.Text);
+        }
+    }
+
+    // dropped by capture queue, before filters could tell whom they were for
+    const int32 QueueDroppedLines = LogCapture->ConsumeDroppedLines();
+
+    for (FLogSubscription& Subscription : LogSubscriptions)
     {
-        CommandArg = Command.Mid(SpaceIndex + 1);
+        Subscription.DroppedLines += QueueDroppedLines;
+        if (Subscription.bCongested)
+            continue;
+
+        if (Subscription.DroppedLines)
+        {
+            FString Summary = FString::Printf(TEXT("... %d log lines dropped"), Subscription.DroppedLines);
+            if (Subscription.Batch.Len())
+            {
+                Summary.AppendChar(TEXT('\n'));
+                Summary.Append(Subscription.Batch);
+            }
+            Subscription.Batch = MoveTemp(Summary);
+            Subscription.DroppedLines = 0;
+        }
+        if (Subscription.Batch.Len())
+        {
+            RConServer.SendPartialResponse(Subscription.RequestId, MoveTemp(Subscription.Batch));
+            Subscription.Batch.Reset();
+        }
     }
+}
+
+TFuture<FString> URConServerSubsystem::OnBatchCommand(int32 RequestId, FStringView Args, TSharedRef<FRConCancellationToken> CancellationToken)
+{
+    // parsed into locals, batch carries promise that should not be destroyed unfulfilled on errors
+    bool bStopOnError{};
+    FString ScriptPath{};
+    Args.TrimStartInline();
+    while (Args.StartsWith(TEXT('-')))
+    {
+        int32 SpaceIndex{};
+        const FStringView Option = Args.FindChar(TEXT(' '), SpaceIndex) ? Args.Left(SpaceIndex) : Args;
+        if (Option.Equals(TEXT("-stoponerror"), ESearchCase::IgnoreCase))
+            bStopOnError = true;
+        else if (Option.StartsWith(TEXT("-file="), ESearchCase::IgnoreCase))
+            ScriptPath = FString(Option.RightChop(6));
+        else
+            return MakeFulfilledPromise<FString>(FString::Printf(TEXT("Unknown batch option '%.*s'"), Option.Len(), Option.GetData())).GetFuture();
 
-    FExecOutputDevice OutputDevice{};
-    const bool bExec = GEngine->Exec(GetWorld(), *CommandArg, OutputDevice);
+        Args.RightChopInline(Option.Len());
+        Args.TrimStartInline();
+    }
 
-    if (bExec)
-        Response = FString::Printf(TEXT("exec: %s; \n %s"), *Command, *OutputDevice.Output);
+    TArray<FString> Lines{};
+    if (!ScriptPath.IsEmpty())
+    {
+        // scripts are limited to their directory, client could not read arbitrary files through error messages
+        const FString ScriptDirectory = FPaths::ConvertRelativePathToFull(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("RCon"), TEXT("Scripts")));
+        const FString FullScriptPath = FPaths::ConvertRelativePathToFull(ScriptDirectory, ScriptPath);
+        if (!FPaths::IsUnderDirectory(FullScriptPath, ScriptDirectory) || !FFileHelper::LoadFileToStringArray(Lines, *FullScriptPath))
+            return MakeFulfilledPromise<FString>(FString::Printf(TEXT("Failed to read script '%s' from %s"), *ScriptPath, *ScriptDirectory)).GetFuture();
+    }
     else
-        Response = FString::Printf(TEXT("exec: %s; \n Failed to execute"), *Command);
+    {
+        static const TCHAR* Delimiters[] = {TEXT(";"), TEXT("\n")};
+        FString(Args).ParseIntoArray(Lines, Delimiters, UE_ARRAY_COUNT(Delimiters));
+    }
+
+    TArray<FString> Commands{};
+    for (FString& Line : Lines)
+    {
+        Line.TrimStartAndEndInline();
+        if (!Line.IsEmpty() && !Line.StartsWith(TEXT("#")))
+            Commands.Add(MoveTemp(Line));
+    }
+    if (Commands.IsEmpty())
+        return MakeFulfilledPromise<FString>(FString(TEXT("Batch has no commands to run"))).GetFuture();
+
+    FBatch Batch{};
+    Batch.Commands = MoveTemp(Commands);
+    Batch.bStopOnError = bStopOnError;
+    Batch.CancellationToken = CancellationToken;
+    Batch.Writer.Reset(RConServer.GetResponseFormat(RequestId));
+    Batch.Writer.BeginArray(TEXT("commands"));
+
+    TFuture<FString> Future = Batch.Promise.GetFuture();
+
+    // short batch completes right away, the rest continues from tick
+    const double BudgetMs = URConServerSettings::Get()->BatchTimeBudgetMs;
+    const double Deadline = BudgetMs > 0.0 ? FPlatformTime::Seconds() + BudgetMs / 1000.0 : MAX_dbl;
+    if (!RunBatch(RequestId, Batch, Deadline))
+        Batches.Emplace(RequestId, MoveTemp(Batch));
+
+    return Future;
+}
+
+bool URConServerSubsystem::RunBatch(int32 RequestId, FBatch& Batch, double Deadline)
+{
+    while (Batch.NextCommand < Batch.Commands.Num())
+    {
+        FString Response{};
+        bool bSuccess{};
+
+        if (Batch.PendingRequest.IsSet())
+        {
+            FAsyncRequest& PendingRequest = Batch.PendingRequest.GetValue();
+            if (!PendingRequest.Future.IsReady())
+                return false;
+
+            if (FCommandHandle* CommandHandle = CommandHandles.Find(PendingRequest.Command))
+                CommandHandle->Stats.Add(FPlatformTime::Seconds() - PendingRequest.StartTime);
+
+            Response = PendingRequest.Future.Consume();
+            bSuccess = true;
+            Batch.PendingRequest.Reset();
+        }
+        else
+        {
+            bool bDelayResponse{};
+            bSuccess = RunCommand(RequestId, Batch.Commands[Batch.NextCommand], true, Response, bDelayResponse, Batch.PendingRequest);
+            if (Batch.PendingRequest.IsSet())
+                continue;
+
+            if (bDelayResponse)
+            {
+                // its response would go to the batch request itself
+                Response = TEXT("Command delayed its response, which is not supported in batch");
+                bSuccess = false;
+            }
+        }
+
+        FRConResponseWriter& Writer = Batch.Writer;
+        Writer.BeginObject();
+        Writer.WriteString(TEXT("command"), Batch.Commands[Batch.NextCommand]);
+        Writer.WriteBool(TEXT("success"), bSuccess);
+        Writer.WriteString(TEXT("response"), Response);
+        Writer.EndObject();
+
+        ++Batch.NextCommand;
+        if (!bSuccess)
+        {
+            ++Batch.NumFailed;
+            if (Batch.bStopOnError)
+                break;
+        }
+
+        if (FPlatformTime::Seconds() >= Deadline)
+            return false;
+    }
+
+    Batch.Writer.EndArray();
+    Batch.Writer.WriteInt(TEXT("completed"), Batch.NextCommand - Batch.NumFailed);
+    Batch.Writer.WriteInt(TEXT("failed"), Batch.NumFailed);
+    Batch.Writer.WriteInt(TEXT("skipped"), Batch.Commands.Num() - Batch.NextCommand);
+    Batch.Promise.SetValue(Batch.Writer.Finish());
+    return true;
+}
+
+void URConServerSubsystem::RunBatches()
+{
+    // shared by all batches, each still runs at least one command per tick
+    const double BudgetMs = URConServerSettings::Get()->BatchTimeBudgetMs;
+    const double Deadline = BudgetMs > 0.0 ? FPlatformTime::Seconds() + BudgetMs / 1000.0 : MAX_dbl;
+
+    for (auto It = Batches.CreateIterator(); It; ++It)
+    {
+        FBatch& Batch = It.Value();
+        if (Batch.CancellationToken->IsCanceled())
+        {
+            if (Batch.PendingRequest.IsSet())
+                Batch.PendingRequest->CancellationToken->Cancel();
+            // nobody waits for it anymore, but promise should not be left unfulfilled
+            Batch.Promise.SetValue(FString());
+            It.RemoveCurrent();
+            continue;
+        }
+
+        if (RunBatch(It.Key(), Batch, Deadline))
+            It.RemoveCurrent();
+    }
+}
+
+TFuture<FString> URConServerSubsystem::OnForkCommand(int32 RequestId, FStringView Args, TSharedRef<FRConCancellationToken> CancellationToken)
+{
+    FString Error = CheckForkRouting();
+    if (!Error.IsEmpty())
+        return MakeFulfilledPromise<FString>(MoveTemp(Error)).GetFuture();
+
+    int32 SpaceIndex{};
+    const FStringView ForkIdArg = Args.FindChar(TEXT(' '), SpaceIndex) ? Args.Left(SpaceIndex) : Args;
+    const FStringView Command = Args.RightChop(ForkIdArg.Len() + 1);
+
+    int32 ForkId{};
+    if (!LexTryParseString(ForkId, *FString(ForkIdArg)) || ForkId < 1 || ForkId > GetNumForks())
+        return MakeFulfilledPromise<FString>(FString::Printf(TEXT("Fork id should be in range of 1 to %d"), GetNumForks())).GetFuture();
+    if (Command.IsEmpty())
+        return MakeFulfilledPromise<FString>(FString(TEXT("Missing command to run on fork"))).GetFuture();
+
+    Error = CheckRoutedCommand(RequestId, Command);
+    if (!Error.IsEmpty())
+        return MakeFulfilledPromise<FString>(MoveTemp(Error)).GetFuture();
+
+    return SendForkCommand(ForkId, FString(Command)).Next([ForkId](FRConClient::FResponse Response)
+        {
+            return Response.bSuccess ? MoveTemp(Response.Body) : FString::Printf(TEXT("Fork %d failed to respond: %s"), ForkId, *Response.Body);
+        });
+}
+
+TFuture<FString> URConServerSubsystem::OnExecAllCommand(int32 RequestId, FStringView Args, TSharedRef<FRConCancellationToken> CancellationToken)
+{
+    const FString Command = FString::Printf(TEXT("exec %.*s"), Args.Len(), Args.GetData());
+
+    FString Error = CheckForkRouting();
+    if (Error.IsEmpty())
+        Error = CheckRoutedCommand(RequestId, Command);
+    if (!Error.IsEmpty())
+        return MakeFulfilledPromise<FString>(MoveTemp(Error)).GetFuture();
+
+    // filled from client thread as fork responses arrive, last one completes promise
+    struct FExecAllState
+    {
+        TPromise<FString> Promise{};
+        TArray<FString> Results{};
+        std::atomic<int32> Remaining{};
+    };
+
+    const int32 NumForks = GetNumForks();
+    TSharedRef<FExecAllState> State = MakeShared<FExecAllState>();
+    State->Results.SetNum(NumForks);
+    State->Remaining = NumForks;
+    TFuture<FString> Future = State->Promise.GetFuture();
+
+    for (int32 ForkId = 1; ForkId <= NumForks; ++ForkId)
+    {
+        SendForkCommand(ForkId, Command).Next([State, ForkId](FRConClient::FResponse Response)
+            {
+                State->Results[ForkId - 1] = FString::Printf(TEXT("[fork %d]%s\n%s"), ForkId, Response.bSuccess ? TEXT("") : TEXT(" failed"), *Response.Body);
+                if (--State->Remaining == 0)
+                    State->Promise.SetValue(FString::Join(State->Results, TEXT("\n")));
+            });
+    }
+    return Future;
+}
+
+FString URConServerSubsystem::CheckForkRouting() const
+{
+    if (URConServerSettings::Get()->ForkRoutingPort <= 0)
+        return TEXT("Fork routing disabled, ForkRoutingPort is not set");
+    if (GetNumForks() == 0)
+        return TEXT("Server is not forked");
+    if (URConServerSettings::Get()->ForkRoutingPort + GetNumForks() > MAX_uint16)
+        return TEXT("ForkRoutingPort is too big for number of forks");
+    return FString();
+}
+
+FString URConServerSubsystem::CheckRoutedCommand(int32 RequestId, FStringView Command)
+{
+    // main password is allowed everything anyway
+    const int32 Principal = RConServer.GetRequestPrincipal(RequestId);
+    if (Principal == 0)
+        return FString();
+
+    // forks run the same commands, so they are checked here against permissions of the caller
+    const FCommandHandle* CommandHandle = FindCommandHandle(Command);
+    if (!CommandHandle)
+        return FString::Printf(TEXT("Command \'%.*s\' not recognized (use \'help\' to list all available commands)"), Command.Len(), Command.GetData());
+    if (!(PrincipalPermissions.IsValidIndex(Principal) && PrincipalPermissions[Principal][CommandHandle->Index]))
+        return FString::Printf(TEXT("Command \'%s\' is not allowed"), *CommandHandle->Command);
+
+    // these run further commands, which would not be checked on fork
+    if (CommandHandle->Command == TEXT("fork") || CommandHandle->Command == TEXT("exec-all") || CommandHandle->Command == TEXT("batch"))
+        return FString::Printf(TEXT("Command \'%s\' could not be routed to fork"), *CommandHandle->Command);
+
+    return FString();
+}
+
+TFuture<FRConClient::FResponse> URConServerSubsystem::SendForkCommand(int32 ForkId, FString Command)
+{
+    if (!ForkClient)
+    {
+        ForkClient = MakeUnique<FRConClient>();
+        ForkClient->Start();
+    }
+
+    uint32* ConnectionId = ForkConnections.Find(ForkId);
+    if (!ConnectionId)
+    {
+        const uint16 RoutingPort = static_cast<uint16>(URConServerSettings::Get()->ForkRoutingPort + ForkId);
+        // logs in with main password, permissions of callers are checked by CheckRoutedCommand before sending
+        ConnectionId = &ForkConnections.Add(ForkId, ForkClient->Connect(TEXT("127.0.0.1"), RoutingPort, GetRConPassword()));
+    }
+
+    return ForkClient->SendCommand(*ConnectionId, MoveTemp(Command));
 }
 
 void URConServerSubsystem::OnPostFork(EForkProcessRole Role)
 {
+    // responses like 'help' listing carry process and fork id
+    InvalidateAllCachedResponses();
+
+    // parent only waits on children from now on, with shared port it would take its share of connections and never accept them
+    if (Role == EForkProcessRole::Parent && URConServerSettings::Get()->bShareForkPort)
+    {
+        StopServer();
+        return;
+    }
+
     if (IsStarted())
     {
         StopServer();
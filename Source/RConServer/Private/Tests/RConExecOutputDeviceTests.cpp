@@ -0,0 +1,56 @@
+// Copyright (c) 2025 Siarhei Dziki aka "GloryOfNight"
+
+#include <Misc/AutomationTest.h>
+
+#include "RConExecOutputDevice.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRConExecOutputCollectTest, "RCon.ExecOutput.Collect", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FRConExecOutputCollectTest::RunTest(const FString& Parameters)
+{
+    // output of a batch command, several chunks worth of it, has to come back whole
+    {
+        FRConExecOutputDevice OutputDevice{nullptr, 1, 0, false};
+        OutputDevice.Write(TEXT("exec: exec dump; \n "));
+
+        const FString Line = FString::ChrN(1000, TEXT('x'));
+        FString Expected = TEXT("exec: exec dump; \n ");
+        const int32 NumLines = 4 * FRConExecOutputDevice::ChunkSize / Line.Len();
+        for (int32 i = 0; i < NumLines; ++i)
+        {
+            OutputDevice.Serialize(*Line, ELogVerbosity::Log, NAME_None);
+            if (i > 0)
+                Expected.AppendChar(TEXT('\n'));
+            Expected.Append(Line);
+        }
+
+        const FString Output = OutputDevice.Finish();
+        TestTrue(TEXT("output bigger than chunk"), Output.Len() > FRConExecOutputDevice::ChunkSize);
+        TestEqual(TEXT("whole output collected"), Output, Expected);
+    }
+
+    // limit still applies without streaming
+    {
+        FRConExecOutputDevice OutputDevice{nullptr, 1, 10, false};
+        OutputDevice.Serialize(TEXT("0123456"), ELogVerbosity::Log, NAME_None);
+        OutputDevice.Serialize(TEXT("789abcdef"), ELogVerbosity::Log, NAME_None);
+        OutputDevice.Serialize(TEXT("ignored"), ELogVerbosity::Log, NAME_None);
+        TestEqual(TEXT("truncated output"), OutputDevice.Finish(), FString(TEXT("0123456\n78\n... output truncated")));
+    }
+
+    // JSON escaped, prefix written as is
+    {
+        FRConExecOutputDevice OutputDevice{nullptr, 1, 0, true};
+        OutputDevice.Write(TEXT("{\"output\":\""));
+        OutputDevice.Serialize(TEXT("say \"hi\""), ELogVerbosity::Log, NAME_None);
+        OutputDevice.Serialize(TEXT("back\\slash"), ELogVerbosity::Log, NAME_None);
+        OutputDevice.Write(TEXT("\"}"));
+        TestEqual(TEXT("escaped output"), OutputDevice.Finish(), FString(TEXT("{\"output\":\"say \\\"hi\\\"\\nback\\\\slash\"}")));
+    }
+
+    return true;
+}
+
+#endif
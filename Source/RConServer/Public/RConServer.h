@@ -2,12 +2,23 @@
 
 #pragma once
 
+#include <Containers/Queue.h>
 #include <CoreMinimal.h>
+#include <GenericPlatform/GenericPlatformFile.h>
+#include <HAL/Runnable.h>
+#include <Misc/SecureHash.h>
 #include <Modules/ModuleManager.h>
 #include <SocketSubsystem.h>
 #include <Sockets.h>
 
+#include <atomic>
+
 #include "RConCommon.h"
+#include "RConResponseWriter.h"
+#include "RConRingBuffer.h"
+
+class FRConSocketPoller;
+class FRunnableThread;
 
 class FRConServerModule : public IModuleInterface
 {
@@ -23,10 +34,31 @@ public:
     FRConServer() = default;
     FRConServer(const FRConServer&) = delete;
     FRConServer(FRConServer&&) = delete;
-    ~FRConServer() = default;
+    ~FRConServer();
+
+    // what to do with client, that does not read responses fast enough to fit into MaxSendBufferSize
+    enum class ESendOverflowPolicy : uint8
+    {
+        // stop receiving commands from client, until it reads what is already buffered
+        // overflow limited to MaxSendBufferSize as well, connection closed once exceeded
+        StopReading,
+        // close connection right away
+        Disconnect,
+        // write rest of responses to file, read back as client catches up
+        SpillToDisk
+    };
 
     DECLARE_DELEGATE(FHandleClientConnectedDelegate);
     DECLARE_DELEGATE_FourParams(FHandleReceivedCommandDelegate, int32 /*RequestId*/, const FString& /*Command*/, FString& /*Response*/, bool& /*bDelayResponse*/);
+    // delayed request will never get its response delivered, client disconnected or request timed out
+    DECLARE_DELEGATE_OneParam(FHandleRequestCanceledDelegate, int32 /*RequestId*/);
+
+    // additional password, told apart from others by command callback through GetRequestPrincipal
+    struct FCredential
+    {
+        FString Name;
+        FString Password;
+    };
 
     struct FSettings
     {
@@ -37,21 +69,131 @@ public:
         {
         }
 
+        // password of principal 0, only hashes of passwords kept after Start
         FString Password;
         uint16 Port;
         bool bAllowPortReuse;
 
+        // principals 1 and above, in order
+        TArray<FCredential> Credentials{};
+
+        // additional port listened on loopback address only, zero for none
+        // lets processes on same host reach this server, while Port shared with others through bAllowPortReuse
+        uint16 LoopbackPort{0};
+
         uint16 MaxActiveConnections{3};
+
+        // pending connections queue size of listen socket
+        int32 ListenBacklog{16};
+
+        // max connections accepted in a single tick
+        int32 MaxAcceptsPerTick{16};
+
+        // packets with bigger size field considered malformed and drop connection
+        int32 MaxPacketSize{CRConMaxPacketSize};
+
+        // bigger responses sent as several packets with same id
+        int32 MaxResponseBodySize{CRConMaxResponseBodySize};
+
+        // run accept/recv/send on own thread, Tick() then only dispatches received commands
+        // ignored on platforms without socket readiness backend, see FRConSocketPoller
+        bool bUseNetworkThread{false};
+
+        // max time in milliseconds network thread waits for socket events, before checking stop request
+        uint32 NetworkThreadWaitTime{100};
+
+        // seconds to wait for delayed response before answering client with timeout, zero to wait forever
+        double DelayedResponseTimeout{60.0};
+
+        // commands executed in a single tick, rest carried over to next one. Zero for no limit
+        int32 MaxCommandsPerTick{16};
+
+        // milliseconds of command execution in a single tick, checked after each command. Zero for no limit
+        double CommandTimeBudgetMs{4.0};
+
+        // commands per second each connection allowed to send on average, extra ones rejected. Zero for no limit
+        double CommandRateLimit{10.0};
+
+        // commands connection could send in a burst, before CommandRateLimit kicks in
+        int32 CommandRateBurst{20};
+
+        // bytes of serialized responses buffered for each connection, allocated once per connection slot
+        int32 MaxSendBufferSize{256 * 1024};
+
+        ESendOverflowPolicy SendOverflowPolicy{ESendOverflowPolicy::StopReading};
+
+        // bytes SpillToDisk could write for single connection, before it is closed anyway
+        int64 MaxSpillSize{64 * 1024 * 1024};
+
+        // connections allowed to wait for authentication at once, extra ones closed right after accept. Zero for no limit
+        int32 MaxUnauthenticatedConnections{2};
+
+        // seconds connection could stay without authentication, counted as failed login once exceeded. Zero for no limit
+        double AuthTimeout{5.0};
+
+        // failed logins from single address before it is banned. Zero to disable throttling
+        int32 MaxAuthFailures{5};
+
+        // seconds for single failed login to be forgotten
+        double AuthFailureDecayTime{60.0};
+
+        // seconds connections from banned address are closed right after accept
+        double AuthBanTime{300.0};
     };
 
     struct FClientConnection
     {
-        uint32 Id;
+        // slot index in low 16 bits, slot generation in high ones, so ids of closed connections never match reused slot
+        uint32 Id{};
+        // bumped each time slot is reused, never zero
+        uint16 Generation{};
         TSharedPtr<FSocket> Socket;
-        TQueue<FRConPacket> SendQueue;
-        bool bAuthorized;
-        // map local requests ids to received ones, needed to avoid collision in received Ids
-        TArray<TPair<int32, int32>> RequestIdMapping;
+        // serialized packets waiting to be sent, fixed capacity of MaxSendBufferSize
+        FRConRingBuffer SendBuffer;
+        // StopReading: packets that did not fit SendBuffer, moved there as it frees up
+        // up to MaxSendBufferSize, responses of commands read before pausing could still exceed it
+        TArray<uint8> SendOverflow;
+        int32 SendOverflowOffset{};
+        // SpillToDisk: same as SendOverflow, but kept in file
+        TUniquePtr<IFileHandle> SpillFile;
+        int64 SpillReadOffset{};
+        int64 SpillWriteOffset{};
+        // socket not watched for reading, until send overflow is drained
+        bool bReadPaused{};
+        // socket watched for write readiness, see UpdateWriteInterest
+        bool bWriteInterest{};
+        bool bAuthorized{};
+        int32 Principal{};
+        // key of peer address in AddressRecords
+        uint32 AddressHash{};
+        double AcceptTime{};
+        // received stream data, may hold partial packet between ticks
+        FRConRingBuffer RecvBuffer;
+        // used only when packet wraps around end of RecvBuffer
+        TArray<uint8> RecvScratch;
+        // token bucket of CommandRateLimit, each command takes one
+        double CommandTokens{};
+        double LastTokenRefillTime{};
+    };
+
+    // totals since server object created, and current queue depths
+    struct FStats
+    {
+        uint64 BytesReceived{};
+        uint64 BytesSent{};
+        uint64 PacketsReceived{};
+        uint64 PacketsSent{};
+        uint64 CommandsDispatched{};
+        uint64 CommandsRateLimited{};
+        uint64 RequestsTimedOut{};
+        uint64 ConnectionsAccepted{};
+        uint64 ConnectionsRefused{};
+        uint64 ConnectionsRejected{};
+        uint64 AuthFailures{};
+        uint32 ActiveConnections{};
+        uint32 QueuedCommands{};
+        uint32 PendingRequests{};
+        uint32 SendBacklog{};
     };
 
     bool Start(const FSettings& InSettings = FSettings());
@@ -62,41 +204,268 @@ public:
 
     void AssignCommandCallback(FHandleReceivedCommandDelegate InCallback);
 
+    void AssignRequestCanceledCallback(FHandleRequestCanceledDelegate InCallback);
+
     int32 GetBoundPort() const { return ListenSocket ? BoundPort : -1; };
 
     bool IsStarted() const { return bStarted; }
 
     void SendResponse(const int32 RequestId, const FString& Response);
 
+    // send part of response ahead of the rest, either from command callback or while response is delayed
+    // parts and final response arrive as separate packets with the same id, empty parts are skipped
+    void SendPartialResponse(const int32 RequestId, FString Response);
+
+    // delayed request never times out, stays open for partial responses until final SendResponse
+    // used to stream data, like log lines, to subscribed clients
+    void KeepRequestOpen(const int32 RequestId);
+
+    // @return bytes queued for connection of the request, that client did not receive yet
+    int32 GetRequestSendBacklog(const int32 RequestId) const;
+
+    // @return id of connection the request came from, zero if request is not pending
+    uint32 GetRequestConnectionId(const int32 RequestId) const;
+
+    // @return principal connection of the request authenticated as: 0 for Password, 1 and above for Credentials. INDEX_NONE if request is not pending
+    int32 GetRequestPrincipal(const int32 RequestId) const;
+
+    // game thread only
+    FStats GetStats() const;
+
+    // format negotiated by connection of the request, Text unless changed
+    ERConResponseFormat GetResponseFormat(const int32 RequestId) const;
+
+    // applies to this and following responses for connection of the request
+    void SetResponseFormat(const int32 RequestId, ERConResponseFormat Format);
+
 private:
+    class FNetworkRunnable;
+
+    enum class EIncomingEventType : uint8
+    {
+        Authenticated,
+        Disconnected,
+        Command,
+        Terminator,
+        // command rejected by CommandRateLimit, answered in order with commands queued before it
+        RateLimited
+    };
+
+    // passed from network side to game thread
+    struct FIncomingEvent
+    {
+        EIncomingEventType Type;
+        uint32 ConnectionId;
+        int32 PacketId;
+        FString Body;
+        // principal of Authenticated connection
+        int32 Principal{};
+    };
+
+    // passed from game thread to network side
+    struct FOutgoingResponse
+    {
+        uint32 ConnectionId;
+        int32 PacketId;
+        FString Body;
+    };
+
+    // commands of a single connection, waiting for their turn on game thread
+    struct FCommandQueue
+    {
+        uint32 ConnectionId{};
+        // commands and terminators, in order received
+        TArray<FIncomingEvent> Events{};
+        int32 Head{};
+    };
+
+    // FStats totals, counted by network side and game thread with relaxed atomics
+    struct FStatCounters
+    {
+        std::atomic<uint64> BytesReceived{};
+        std::atomic<uint64> BytesSent{};
+        std::atomic<uint64> PacketsReceived{};
+        std::atomic<uint64> PacketsSent{};
+        std::atomic<uint64> CommandsDispatched{};
+        std::atomic<uint64> CommandsRateLimited{};
+        std::atomic<uint64> RequestsTimedOut{};
+        std::atomic<uint64> ConnectionsAccepted{};
+        std::atomic<uint64> ConnectionsRefused{};
+        std::atomic<uint64> ConnectionsRejected{};
+        std::atomic<uint64> AuthFailures{};
+        std::atomic<uint32> ActiveConnections{};
+    };
+
+    // failed logins of single peer address, network side only
+    struct FAddressRecord
+    {
+        uint32 AddressHash{};
+        // failed logins, decayed over time by AuthFailureDecayTime
+        double FailureScore{};
+        double LastUpdateTime{};
+        double BanEndTime{};
+    };
+
+    // where response for delayed request should go
+    struct FPendingRequest
+    {
+        uint32 ConnectionId;
+        int32 PacketId;
+        // excluded from DelayedResponseTimeout
+        bool bKeepOpen{};
+    };
+
     static ISocketSubsystem* GetSocketSubsystem();
 
-    void ProcessNewConnections();
-    void TryPurgeOldConnections();
+    // salted digest of principal password, computed once at Start
+    struct FCredentialDigest
+    {
+        uint8 Salt[16];
+        uint8 Digest[FSHA1::DigestSize];
+    };
+
+    static void ComputeCredentialDigest(const uint8* Salt, FStringView Password, uint8* OutDigest);
+
+    // every digest compared in full, so time spent does not hint which one matched or how close the guess was
+    // @return index of principal, INDEX_NONE if password matches none
+    int32 FindPrincipal(FStringView Password) const;
+
+    // fixed size of AddressRecords, power of two
+    static constexpr int32 AddressTableSize = 1024;
+    // records probed for address, before least recently updated one is replaced
+    static constexpr int32 AddressTableProbes = 4;
+
+    // poller key of listen socket, connection ids used as keys for client sockets
+    static constexpr uint32 ListenSocketKey = 0;
+    static constexpr uint32 LoopbackListenSocketKey = 1;
+
+    // @param Address updated with bound port
+    // @param PortCount ports tried after requested one, when it is taken
+    static FUniqueSocket CreateListenSocket(FInternetAddr& Address, const FSettings& InSettings, int32 PortCount);
+
+    // network side, either called from Tick or network thread
+    void TickNetwork(uint32 WaitTime);
+    void FlushOutgoing();
+    FClientConnection* FindConnection(uint32 ConnectionId);
+
+    // game thread side
+    const FPendingRequest* FindRequest(int32 RequestId) const;
+    void DispatchIncomingEvents();
+    void QueueCommand(FIncomingEvent&& Event);
+    void RemoveConnectionCommands(uint32 ConnectionId);
+    void DispatchQueuedCommands();
+    void DispatchCommand(FIncomingEvent& Event);
+    void RemoveConnectionRequests(uint32 ConnectionId);
+    void ExpirePendingRequests();
+    void EnqueueOutgoing(uint32 ConnectionId, int32 PacketId, FString Body);
+    // feeds 'stat rcon' with per frame deltas of counters
+    void PublishStats();
+
+    void ProcessNewConnections(FSocket* AcceptingSocket);
+    FClientConnection* AcquireConnectionSlot();
+
+    // @return whether connection from the address should be closed before slot is taken
+    bool IsAddressBanned(uint32 AddressHash, double Now);
+    // @param bAdd replace least recently updated record, when address has none
+    // @return nullptr if throttling disabled, or address has no record and bAdd not set
+    FAddressRecord* FindAddressRecord(uint32 AddressHash, bool bAdd);
+    void RecordAuthFailure(FClientConnection& Connection, double Now);
+    void CloseUnauthenticatedConnections(double Now);
 
-    bool CheckConnection(FClientConnection& Connection);
     void ProcessIncoming(FClientConnection& Connection);
+    void ProcessReceivedPackets(FClientConnection& Connection);
+    void ProcessPacket(FClientConnection& Connection, FRConPacket& Packet);
+    bool TryConsumeCommandToken(FClientConnection& Connection);
     void ProcessOutcoming(FClientConnection& Connection);
+    // watch socket for write readiness while SendBuffer has data socket did not take
+    void UpdateWriteInterest(FClientConnection& Connection);
     void CloseConnection(FClientConnection& Connection);
 
-    void EnqueueResponse(FClientConnection& Connection, int32 RequestId, ERConPacketType Type, const FString& Payload);
+    void EnqueueResponse(FClientConnection& Connection, int32 RequestId, ERConPacketType Type, FStringView Payload);
+    void EnqueuePacket(FClientConnection& Connection, int32 Id, ERConPacketType Type, FStringView Body);
+
+    // apply SendOverflowPolicy to data, that does not fit into SendBuffer
+    void EnqueueOverflow(FClientConnection& Connection, const uint8* Data, int32 Size);
+    // move overflow data into SendBuffer, as much as it fits
+    void RefillSendBuffer(FClientConnection& Connection);
+    bool SpillToDisk(FClientConnection& Connection, const uint8* Data, int32 Size);
+    void CloseSpillFile(FClientConnection& Connection);
+    static FString GetSpillFilePath(const FClientConnection& Connection);
 
-    bool SendPacket(TSharedPtr<FSocket>& Socket, const struct FRConPacket& Packet);
+    static bool HasSendOverflow(const FClientConnection& Connection);
+    static int32 GetSendBacklog(const FClientConnection& Connection);
 
     FSettings Settings{};
 
     FUniqueSocket ListenSocket{};
     int32 BoundPort{};
+    FUniqueSocket LoopbackListenSocket{};
 
     FHandleClientConnectedDelegate ClientConnectedCallback{};
 
     FHandleReceivedCommandDelegate ExecCommandCallback{};
 
-    uint32 LastId{};
+    FHandleRequestCanceledDelegate RequestCanceledCallback{};
+
+    uint32 RefusedConnections{};
+    uint32 LastLoggedRefusedConnections{};
+    uint32 RejectedConnections{};
+    uint32 LastLoggedRejectedConnections{};
+    double LastRefusedLogTime{};
+
+    // peer address of accepted socket, reused to keep rejections cheap
+    TSharedPtr<FInternetAddr> PeerAddress{};
+    TArray<FAddressRecord> AddressRecords{};
+    int32 UnauthenticatedConnections{};
+
+    // fixed pool of MaxActiveConnections entries, connection objects and their buffers reused between clients
+    TArray<FClientConnection> ConnectionSlots{};
+    TArray<uint16> FreeSlots{};
+    // indices of slots with open socket, the only ones visited each tick
+    TArray<uint16> LiveSlots{};
+
+    TQueue<FIncomingEvent, EQueueMode::Spsc> IncomingEvents{};
+    TQueue<FOutgoingResponse, EQueueMode::Mpsc> OutgoingResponses{};
+
+    // network side, packets that wrap around end of SendBuffer serialized here first
+    TArray<uint8> SendScratch{};
+
+    FStatCounters StatCounters{};
+    // game thread only, counters as of previous PublishStats
+    FStats PublishedStats{};
+
+    // unsent bytes of each connection slot, published by network side after each send
+    TUniquePtr<std::atomic<int32>[]> SendBacklogs{};
+
+    // game thread only. Indexed by connection slot, so reused between clients
+    TArray<FCommandQueue> CommandQueues{};
+    // slots with queued commands, served round robin one command at a time
+    TArray<uint16> ReadyCommandQueues{};
+    int32 NextReadyCommandQueue{};
+
+    // game thread only. Map local requests ids to connection and received ones, needed to avoid collision in received Ids
     uint32 LastRequestId{};
-    uint16 ActiveConnections{};
+    TMap<int32, FPendingRequest> PendingRequests{};
+    // request currently executed by command callback, not in PendingRequests yet
+    int32 DispatchingRequestId{INDEX_NONE};
+    FPendingRequest DispatchingRequest{};
+    // timeout is the same for every request, so deadlines queued in order they expire
+    TQueue<TPair<int32, double>> PendingRequestDeadlines{};
+
+    // game thread only. Connections that asked for other than Text responses
+    TMap<uint32, ERConResponseFormat> ResponseFormats{};
+
+    // game thread, principal of each authenticated connection
+    TMap<uint32, int32> ConnectionPrincipals{};
+
+    // indexed by principal
+    TArray<FCredentialDigest> CredentialDigests{};
+
+    TUniquePtr<FRConSocketPoller> Poller{};
+    TArray<uint32> ReadyKeys{};
 
-    TArray<TUniquePtr<FClientConnection>> ClientConnections{};
+    TUniquePtr<FNetworkRunnable> NetworkRunnable{};
+    TUniquePtr<FRunnableThread> NetworkThread{};
 
     bool bStarted{};
 };
@@ -8,6 +8,36 @@
 
 #include "RConServerSettings.generated.h"
 
+// Additional RCon password, limited to some commands
+USTRUCT()
+struct FRConCredential
+{
+    GENERATED_BODY()
+
+    // Shown in log once client authenticated with this credential
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    FString Name{};
+
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    FString Password{};
+
+    // Registered commands this credential could execute, "*" for all of them
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    TArray<FString> AllowedCommands{};
+};
+
+// Mirrors FRConServer::ESendOverflowPolicy
+UENUM()
+enum class ERConSendOverflowPolicy : uint8
+{
+    // Stop reading commands from client, until it receives already buffered responses, connection closed once overflow exceeds MaxSendBufferSize
+    StopReading,
+    // Close connection
+    Disconnect,
+    // Buffer responses in file under Saved/RCon, connection closed once MaxSpillSize exceeded
+    SpillToDisk
+};
+
 UCLASS(Config = Game)
 class RCONSERVER_API URConServerSettings : public UDeveloperSettings
 {
@@ -25,9 +55,97 @@ public:
     UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
     FString Password{TEXT("1111")};
 
+    // Passwords besides the main one, each allowed only its own set of commands
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    TArray<FRConCredential> Credentials{};
+
     UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
     uint16 MaxActiveConnections{5};
 
+    // Forks listen on the same Port, system distributes connections between them. Otherwise each fork listens on Port + fork id
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    bool bShareForkPort{false};
+
+    // Forks also listen on loopback ForkRoutingPort + fork id, so 'fork' and 'exec-all' commands could reach other forks. Zero to disable
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 ForkRoutingPort{0};
+
+    // Pending connections queue size of listen socket, connections beyond that refused by system
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 ListenBacklog{16};
+
+    // Run RCon socket work on dedicated thread, only command execution stays on game thread
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    bool bUseNetworkThread{false};
+
+    // Seconds to wait for delayed command response before client receives timeout, zero to wait forever
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    double DelayedResponseTimeout{60.0};
+
+    // Commands executed per tick, rest carried over to next tick taking turns between clients. Zero for no limit
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 MaxCommandsPerTick{16};
+
+    // Milliseconds of command execution allowed per tick, at least one command always executed. Zero for no limit
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    double CommandTimeBudgetMs{4.0};
+
+    // Commands per second each client allowed to send on average, commands beyond that rejected. Zero for no limit
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    double CommandRateLimit{10.0};
+
+    // Commands client could send at once, before CommandRateLimit applies
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 CommandRateBurst{20};
+
+    // Bytes of responses buffered for each client, allocated once per connection slot
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 MaxSendBufferSize{256 * 1024};
+
+    // What to do with client, that does not receive responses fast enough to fit into MaxSendBufferSize
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    ERConSendOverflowPolicy SendOverflowPolicy{ERConSendOverflowPolicy::StopReading};
+
+    // Bytes of responses single client could spill to disk with SpillToDisk policy
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int64 MaxSpillSize{64 * 1024 * 1024};
+
+    // Clients allowed to wait for authentication at once, extra connections closed right after accept. Zero for no limit
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 MaxUnauthenticatedConnections{2};
+
+    // Seconds client has to authenticate, counted as failed login once exceeded. Zero for no limit
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    double AuthTimeout{5.0};
+
+    // Failed logins from single address before it is banned. Zero to disable login throttling
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 MaxAuthFailures{5};
+
+    // Seconds for single failed login to be forgotten
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    double AuthFailureDecayTime{60.0};
+
+    // Seconds connections from banned address are closed right after accept
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    double AuthBanTime{300.0};
+
+    // Milliseconds per tick spent running commands of 'batch', at least one command always run. Zero for no limit
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    double BatchTimeBudgetMs{4.0};
+
+    // Max characters of exec command output sent to client, the rest is cut off. Zero for no limit
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 MaxExecOutputSize{4 * 1024 * 1024};
+
+    // Log lines waiting to be sent to subscribed clients, lines beyond that dropped
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 MaxLogQueueLines{10000};
+
+    // Bytes not yet received by subscribed client, after which its log lines dropped and later summarized
+    UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
+    int32 MaxLogBacklog{256 * 1024};
+
     // Allow launching RCon server subsystem in editor build
     UPROPERTY(Config, EditAnywhere, Category = "RCon Server Settings")
     bool bAllowInEditorBuild{true};
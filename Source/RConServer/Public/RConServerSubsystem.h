@@ -2,16 +2,43 @@
 
 #pragma once
 
+#include <Async/Future.h>
 #include <Containers/Ticker.h>
 #include <CoreMinimal.h>
 #include <Subsystems/GameInstanceSubsystem.h>
 
+#include <atomic>
+
+#include "RConClient.h"
 #include "RConServer.h"
 
 #include "RConServerSubsystem.generated.h"
 
+class FRConLogCapture;
+
 using FRConServerCommandCallback = FRConServer::FHandleReceivedCommandDelegate;
 
+// Same as FRConServerCommandCallback, but receives only arguments following the matched command
+DECLARE_DELEGATE_FourParams(FRConServerCommandArgsCallback, int32 /*RequestId*/, FStringView /*Args*/, FString& /*Response*/, bool& /*bDelayResponse*/);
+
+// Writes typed fields instead of formatted text, serialized in format client picked with 'format' command
+DECLARE_DELEGATE_ThreeParams(FRConServerCommandStructuredCallback, int32 /*RequestId*/, FStringView /*Args*/, FRConResponseWriter& /*Writer*/);
+
+// Shared between async command and its work, canceled once client disconnected or request timed out
+class FRConCancellationToken
+{
+public:
+    bool IsCanceled() const { return bCanceled.load(std::memory_order_relaxed); }
+    void Cancel() { bCanceled.store(true, std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> bCanceled{};
+};
+
+// Called on game thread, returned future completed from any thread sends its value as response
+// Args valid only during the call, copy it before passing into async work
+DECLARE_DELEGATE_RetVal_ThreeParams(TFuture<FString>, FRConServerCommandAsyncCallback, int32 /*RequestId*/, FStringView /*Args*/, TSharedRef<FRConCancellationToken> /*CancellationToken*/);
+
 UCLASS()
 class RCONSERVER_API URConServerSubsystem : public UGameInstanceSubsystem
 {
@@ -19,17 +46,53 @@ class RCONSERVER_API URConServerSubsystem : public UGameInstanceSubsystem
 public:
     struct FCommandProperties
     {
+        FCommandProperties()
+            : bAllowInBatch{true}
+            , CacheTTL{0.0}
+        {
+        }
+
         // Extra information for 'help <command>'
         FString Help;
+        // Could be run by 'batch', commands keeping their request open should not
+        bool bAllowInBatch;
+        // Seconds same command line served from cached response without calling handler. Negative to cache until InvalidateCachedResponses, zero to not cache
+        // Only for read-only commands, which response depends on nothing but command line and response format. Async and delayed responses never cached
+        double CacheTTL;
+    };
+
+    // Execution time of command, async ones measured until their future completes
+    struct FCommandStats
+    {
+        // decades of microseconds: under 100us, 1ms, 10ms, 100ms, 1s and the rest
+        static constexpr int32 NumBuckets = 6;
+
+        void Add(double Seconds);
+
+        uint64 Count{};
+        double TotalTime{};
+        double MaxTime{};
+        uint64 Buckets[NumBuckets]{};
     };
 
     struct FCommandHandle
     {
         FString Command{};
         FRConServer::FHandleReceivedCommandDelegate Callback{};
+        // Used instead of Callback, when bound
+        FRConServerCommandArgsCallback ArgsCallback{};
+        // Used instead of Callback and ArgsCallback, when bound
+        FRConServerCommandStructuredCallback StructuredCallback{};
+        // Used instead of any other callback, when bound
+        FRConServerCommandAsyncCallback AsyncCallback{};
         // Short description for command displayed after command name in 'help'
         FString Tooltip{};
         FCommandProperties Properties{};
+        FCommandStats Stats{};
+        // bit of command in principal permissions, assigned once registered
+        int32 Index{INDEX_NONE};
+
+        bool IsBound() const { return Callback.IsBound() || ArgsCallback.IsBound() || StructuredCallback.IsBound() || AsyncCallback.IsBound(); }
     };
 
     static URConServerSubsystem* Get(const UObject* Context);
@@ -40,6 +103,9 @@ public:
 
     static uint16 GetRConMaxActiveConnections();
 
+    // @return number of forks requested with -NumForks=, zero if process does not fork
+    static int32 GetNumForks();
+
     // @return true subsystem should be created
     static bool ShouldCreateSubsystem_StaticCheck();
 
@@ -56,11 +122,95 @@ public:
 
     void AddCommand(FString InCommand, FRConServerCommandCallback InCallback, FString InTooltip = TEXT(""), FCommandProperties InProperties = FCommandProperties());
 
+    void AddCommand(FString InCommand, FRConServerCommandArgsCallback InCallback, FString InTooltip = TEXT(""), FCommandProperties InProperties = FCommandProperties());
+
+    void AddCommand(FString InCommand, FRConServerCommandStructuredCallback InCallback, FString InTooltip = TEXT(""), FCommandProperties InProperties = FCommandProperties());
+
+    void AddCommand(FString InCommand, FRConServerCommandAsyncCallback InCallback, FString InTooltip = TEXT(""), FCommandProperties InProperties = FCommandProperties());
+
     void AddCommand(FCommandHandle InCommandHandle);
 
-    FCommandHandle* FindCommandHandle(const FString& Command);
+    // @return handle of longest registered command, that input command starts with
+    FCommandHandle* FindCommandHandle(FStringView Command);
+
+    // @param OutArgs rest of the input command after matched one
+    FCommandHandle* FindCommandHandle(FStringView Command, FStringView& OutArgs);
+
+    // drop cached responses of registered command, once its handler knows they are outdated
+    void InvalidateCachedResponses(const FString& Command);
+
+    void InvalidateAllCachedResponses();
 
 private:
+    struct FAsyncRequest
+    {
+        TFuture<FString> Future;
+        TSharedRef<FRConCancellationToken> CancellationToken;
+        // for FCommandStats once completed, handle could be gone by then
+        FString Command;
+        double StartTime;
+    };
+
+    // connection receiving captured log lines as partial responses of its subscribe request
+    struct FLogSubscription
+    {
+        int32 RequestId{};
+        ELogVerbosity::Type Verbosity{};
+        // empty for all categories
+        TArray<FName> Categories{};
+        // lines collected this tick, sent as single packet
+        FString Batch{};
+        // lines skipped, while client was too slow to receive them
+        int32 DroppedLines{};
+        // client has not received enough of already sent data, checked each tick
+        bool bCongested{};
+    };
+
+    // commands of 'batch' request, run a few each tick within BatchTimeBudgetMs
+    struct FBatch
+    {
+        TArray<FString> Commands{};
+        // command running or to be run next
+        int32 NextCommand{};
+        int32 NumFailed{};
+        bool bStopOnError{};
+        // combined response, one entry for each command run
+        FRConResponseWriter Writer{};
+        TPromise<FString> Promise{};
+        TSharedPtr<FRConCancellationToken> CancellationToken{};
+        // async command of the batch, waited for before the next one
+        TOptional<FAsyncRequest> PendingRequest{};
+    };
+
+    // response of command with CacheTTL, keyed by full command line
+    struct FCachedResponse
+    {
+        FString Response{};
+        // registered command, that produced response
+        FString Command{};
+        ERConResponseFormat Format{};
+        double ExpireTime{};
+    };
+
+    // distinct command lines cached at once, arguments could make them endless
+    static constexpr int32 MaxCachedResponses = 256;
+
+    // One word of registered commands, children are words that could follow it
+    struct FCommandTrieNode
+    {
+        FString Token{};
+        TArray<int32> Children{};
+        // set if words from root up to this node form registered command
+        FCommandHandle* Handle{};
+    };
+
+    void RebuildCommandTrie();
+
+    int32 FindCommandTrieChild(int32 NodeIndex, FStringView Token) const;
+
+    // resolves AllowedCommands of credentials into bits of registered commands
+    void RebuildPermissions();
+
     void TryAutoStart();
 
     bool TickServer(float DeltaTime);
@@ -69,13 +219,61 @@ private:
 
     void HandleRConCommand(int32 RequestId, const FString& Command, FString& Response, bool& bDelayResponse);
 
+    // finds and runs command on behalf of the request, either from client or from batch
+    // @param OutAsyncRequest set for async command, caller waits for its future
+    // @return false if command not recognized, not allowed, failed to start or reported failure through bCommandFailed
+    bool RunCommand(int32 RequestId, const FString& Command, bool bInBatch, FString& Response, bool& bDelayResponse, TOptional<FAsyncRequest>& OutAsyncRequest);
+
+    void HandleRequestCanceled(int32 RequestId);
+
+    void CompleteAsyncRequests();
+
     void OnConsoleStartServer(const TArray<FString>& Args, FOutputDevice& OutputDevice);
 
     void OnConsoleStopServer(const TArray<FString>& Args, FOutputDevice& OutputDevice);
 
-    void OnHelpCommand(int32 RequestId, const FString& Command, FString& Response, bool& bDelayResponse);
+    void OnConsoleStats(const TArray<FString>& Args, FOutputDevice& OutputDevice);
+
+    void OnStatsCommand(int32 RequestId, FStringView Args, FRConResponseWriter& Writer);
+
+    // server counters, rates since previous call and latencies of commands
+    void WriteStats(FRConResponseWriter& Writer);
+
+    void OnHelpCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse);
+
+    void OnExecCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse);
+
+    void OnFormatCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse);
+
+    void OnSubscribeCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse);
+
+    void OnUnsubscribeCommand(int32 RequestId, FStringView Args, FString& Response, bool& bDelayResponse);
+
+    // captures log only while there are subscriptions
+    void UpdateLogCapture();
+
+    void SendLogLines();
+
+    TFuture<FString> OnBatchCommand(int32 RequestId, FStringView Args, TSharedRef<FRConCancellationToken> CancellationToken);
 
-    void OnExecCommand(int32 RequestId, const FString& Command, FString& Response, bool& bDelayResponse);
+    // @return true once batch finished and its promise completed
+    bool RunBatch(int32 RequestId, FBatch& Batch, double Deadline);
+
+    void RunBatches();
+
+    TFuture<FString> OnForkCommand(int32 RequestId, FStringView Args, TSharedRef<FRConCancellationToken> CancellationToken);
+
+    TFuture<FString> OnExecAllCommand(int32 RequestId, FStringView Args, TSharedRef<FRConCancellationToken> CancellationToken);
+
+    // @return error message if commands could not be routed to other forks, empty otherwise
+    FString CheckForkRouting() const;
+
+    // fork runs routed command with main password permissions, so caller's permissions are checked before sending
+    // @return error message if caller of the request is not allowed to route the command, empty otherwise
+    FString CheckRoutedCommand(int32 RequestId, FStringView Command);
+
+    // @return future of fork response, request goes over loopback to routing port of that fork
+    TFuture<FRConClient::FResponse> SendForkCommand(int32 ForkId, FString Command);
 
     void OnPostFork(EForkProcessRole);
 
@@ -84,4 +282,41 @@ private:
     FTSTicker::FDelegateHandle TickHandle{};
 
     TMap<FString, FCommandHandle> CommandHandles{};
+
+    // rebuilt on AddCommand, so lookups walk input command once without allocations. Root node at index 0
+    TArray<FCommandTrieNode> CommandTrie{};
+
+    // commands each principal is allowed to execute, indexed by principal and then FCommandHandle::Index
+    TArray<TBitArray<>> PrincipalPermissions{};
+
+    // reused for structured commands, so building response does not grow a fresh buffer each time
+    FRConResponseWriter ResponseWriter{};
+
+    // async commands in flight, checked each tick for completed futures
+    TMap<int32, FAsyncRequest> AsyncRequests{};
+
+    TMap<FString, FCachedResponse> CachedResponses{};
+
+    // batches with commands left to run, each also tracked in AsyncRequests
+    TMap<int32, FBatch> Batches{};
+
+    // set while command of a batch runs, its output should not be streamed under request id of the batch
+    bool bRunningBatchCommand{};
+
+    // set by callbacks that have no failure status of their own, like exec of command engine did not handle
+    bool bCommandFailed{};
+
+    // rates in WriteStats computed against previous call
+    FRConServer::FStats LastStats{};
+    double LastStatsTime{};
+
+    TArray<FLogSubscription> LogSubscriptions{};
+
+    // registered on GLog while LogSubscriptions not empty, kept alive with subsystem since other threads may still log into it
+    TSharedPtr<FRConLogCapture> LogCapture{};
+    bool bLogCaptureRegistered{};
+
+    // connections to routing ports of forks, opened by first routed command and closed once no async request left
+    TUniquePtr<FRConClient> ForkClient{};
+    TMap<int32, uint32> ForkConnections{};
 };
\ No newline at end of file